@@ -1,14 +1,30 @@
 #include "power/iohub_chacon_dio.h"
+#include "light/iohub_light_seamaid.h"
+#include "heatpump/iohub_heatpump_midea.h"
 #include "lcd/iohub_hd44780_lcd.h"
 #include "sensor/iohub_rs8706w_weatherlink.h"
 #include "heater/iohub_cc1101.h"
-
-#define CC1101_SAUTER
-#include "iohub_cc1101_default_value.h"
+#include "heater/iohub_cc1101_default_value.sauter.h"
+#include "heater/iohub_cc1101_default_value.ook.h"
+#include "utils/iohub_tx_timing.h"
+#include "platform/iohub_platform.h"
+#ifdef IOHUB_PLATFORM_LINUX
+#include "platform/linux/iohub_cc1101_sim.h"
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#define CLI_CC1101_CSN_PIN          0
+#define CLI_CC1101_GDO0_PIN         1
+#define CLI_CC1101_GDO2_PIN         3
+#define CLI_TX_PIN                  0
+#define CLI_RX_PIN                  2
+
+#define CLI_TX_TIMING_TOLERANCE_US  100
+#define CLI_TX_WAVEFORM_RATE_PCT    2
 
 /* --------------------------------------------------------------------------------------------
                                         LCD
@@ -53,15 +69,16 @@ static void cc1101_send(void)
         0x00, 0x00, 0x00, 0x08, 0x0b, 0xbb, 0x77
     };
 
-    if (iohub_cc1101_init(&ctx, 0, 1, sCC1101_Default_Config) != SUCCESS) {
+    if (iohub_cc1101_init(&ctx, CLI_CC1101_CSN_PIN, CLI_CC1101_GDO0_PIN, sC1101SauterConfig, CC1101_PATABLE_FIRSTBYTE) != SUCCESS) {
         fprintf(stderr, "CC1101 init failed\n");
         return;
     }
 
     for (;;) {
-        memcpy(packet.mData, data, sizeof(data));
-        packet.mLength = sizeof(data);
-        int ret = iohub_cc1101_send(&ctx, &packet);
+        packet.mDst = data[0];
+        memcpy(packet.mData, &data[1], sizeof(data) - 1);
+        packet.mLength = sizeof(data) - 1;
+        int ret = iohub_cc1101_send_data(&ctx, &packet);
         if (ret != SUCCESS)
             fprintf(stderr, "Error while sending packet: %d\n", ret);
         sleep(2);
@@ -73,13 +90,16 @@ static void cc1101_listen(void)
     cc1101_ctx ctx;
     cc1101_packet_ctx packet;
 
-    if (iohub_cc1101_init(&ctx, 0, 1, sCC1101_Default_Config) != SUCCESS) {
+    if (iohub_cc1101_init(&ctx, CLI_CC1101_CSN_PIN, CLI_CC1101_GDO0_PIN, sC1101SauterConfig, CC1101_PATABLE_FIRSTBYTE) != SUCCESS) {
         fprintf(stderr, "CC1101 init failed\n");
         return;
     }
 
+    iohub_cc1101_wakeup(&ctx);
+    iohub_cc1101_set_receive(&ctx);
+
     for (;;) {
-        if (iohub_cc1101_receive(&ctx, &packet) > 0) {
+        if (iohub_cc1101_receive_data_timeout(&ctx, &packet, 1000) == SUCCESS && packet.mLength > 0) {
             printf("Packet received (%d bytes): ", packet.mLength);
             for (int i = 0; i < packet.mLength; ++i)
                 printf("%02X ", packet.mData[i]);
@@ -88,6 +108,324 @@ static void cc1101_listen(void)
     }
 }
 
+// One line per sweep, one character per channel from ' ' (noise floor) to '#' (+40 dB)
+static void cc1101_scan(unsigned first, unsigned count)
+{
+    static const char levels[] = " .:-=+*%#";
+    cc1101_ctx ctx;
+    s16 rssi[256];
+    s16 noise_floor;
+
+    // Channel numbers and the driver channel count are both u8
+    if (first > 255 || count == 0 || count > 255 || count > 256 - first) {
+        fprintf(stderr, "Invalid channel range\n");
+        return;
+    }
+
+    if (iohub_cc1101_init(&ctx, CLI_CC1101_CSN_PIN, CLI_CC1101_GDO0_PIN, sC1101SauterConfig, CC1101_PATABLE_FIRSTBYTE) != SUCCESS) {
+        fprintf(stderr, "CC1101 init failed\n");
+        return;
+    }
+
+    for (;;) {
+        uint64_t start_us = iohub_time_now_us();
+        if (iohub_cc1101_scan(&ctx, (u8)first, (u8)count, 0, rssi, &noise_floor) != SUCCESS) {
+            fprintf(stderr, "Scan failed\n");
+            return;
+        }
+
+        char line[257];
+        for (unsigned i = 0; i < count; ++i) {
+            int level = (rssi[i] - noise_floor) / 5;
+            if (level < 0)
+                level = 0;
+            if (level > (int)sizeof(levels) - 2)
+                level = sizeof(levels) - 2;
+            line[i] = levels[level];
+        }
+        line[count] = 0;
+
+        printf("|%s| floor %4d dBm  %5lu us\n", line, noise_floor, (unsigned long)(iohub_time_now_us() - start_us));
+        fflush(stdout);
+    }
+}
+
+#ifdef IOHUB_PLATFORM_LINUX
+
+#define CLI_SIM_A_CSN_PIN           10
+#define CLI_SIM_A_GDO0_PIN          11
+#define CLI_SIM_B_CSN_PIN           12
+#define CLI_SIM_B_GDO0_PIN          13
+#define CLI_SIM_A_GDO2_PIN          14
+#define CLI_SIM_B_GDO2_PIN          15
+
+// SPI transaction budgets, -cc1101sim fails when a step needs more
+#define CLI_SIM_INIT_TRANSACTIONS       15
+#define CLI_SIM_WARM_INIT_TRANSACTIONS  4
+
+static volatile unsigned sSimGDO2Edges = 0;
+
+static void cc1101_sim_gdo2_edge(void *arg)
+{
+    (void)arg;
+    sSimGDO2Edges++;
+}
+
+// Prints and resets the counters of one radio, returns its SPI transaction count
+static u32 cc1101_sim_report(const char *name, u32 csn_pin, cc1101_sim *sim)
+{
+    iohub_linux_spi_stats stats;
+    iohub_linux_spi_get_stats(csn_pin, &stats);
+
+    printf("  %-8s transactions=%4lu bytes=%5lu cs_edges=%4lu strobes=%3lu calibrations=%2lu\n",
+           name, stats.mTransactionCount, stats.mByteCount, stats.mCSToggleCount,
+           sim->mStats.mStrobeCount, sim->mStats.mCalibrationCount);
+
+    iohub_linux_spi_reset_stats(csn_pin);
+    memset(&sim->mStats, 0x00, sizeof(sim->mStats));
+
+    return stats.mTransactionCount;
+}
+
+// 1 when a step went over its SPI transaction budget
+static int cc1101_sim_budget(const char *step, u32 transactions, u32 budget)
+{
+    if (transactions <= budget)
+        return 0;
+
+    fprintf(stderr, "  %s: %lu SPI transactions, budget %lu: FAIL\n", step, transactions, budget);
+    return 1;
+}
+
+// Sends a packet from radio A to radio B through the register level model, 0 on success
+static int cc1101_sim_exchange(cc1101_ctx *a, cc1101_ctx *b, u8 length)
+{
+    cc1101_packet_ctx tx, rx;
+
+    tx.mDst = 0x00;
+    tx.mLength = length;
+    for (int i = 0; i < length; ++i)
+        tx.mData[i] = (u8)(i * 7 + length);
+
+    iohub_cc1101_wakeup(b);
+    iohub_cc1101_set_receive(b);
+
+    int ret = iohub_cc1101_send_data(a, &tx);
+    if (ret == SUCCESS)
+        ret = iohub_cc1101_receive_data_timeout(b, &rx, 100);
+
+    iohub_cc1101_standby(b);
+
+    if (ret != SUCCESS || rx.mLength != tx.mLength || memcmp(rx.mData, tx.mData, tx.mLength) != 0) {
+        fprintf(stderr, "  %u bytes packet: FAIL (%d, received %u bytes)\n", length, ret, rx.mLength);
+        return 1;
+    }
+
+    printf("  %u bytes packet: OK\n", length);
+    return 0;
+}
+
+// Runs the driver against two simulated radios and prints the SPI cost of each step
+static bool cc1101_sim_check(void)
+{
+    static cc1101_sim sim_a, sim_b;
+    cc1101_ctx a, b;
+    int failures = 0;
+
+    iohub_cc1101_sim_init(&sim_a, CLI_SIM_A_CSN_PIN, CLI_SIM_A_GDO0_PIN);
+    iohub_cc1101_sim_init(&sim_b, CLI_SIM_B_CSN_PIN, CLI_SIM_B_GDO0_PIN);
+    iohub_cc1101_sim_connect(&sim_a, &sim_b);
+
+    if (iohub_cc1101_init(&a, CLI_SIM_A_CSN_PIN, CLI_SIM_A_GDO0_PIN, sC1101SauterConfig, CC1101_PATABLE_FIRSTBYTE) != SUCCESS ||
+        iohub_cc1101_init(&b, CLI_SIM_B_CSN_PIN, CLI_SIM_B_GDO0_PIN, sC1101SauterConfig, CC1101_PATABLE_FIRSTBYTE) != SUCCESS) {
+        fprintf(stderr, "CC1101 init failed\n");
+        return false;
+    }
+
+    printf("init:\n");
+    failures += cc1101_sim_budget("init A", cc1101_sim_report("radio A", CLI_SIM_A_CSN_PIN, &sim_a), CLI_SIM_INIT_TRANSACTIONS);
+    failures += cc1101_sim_budget("init B", cc1101_sim_report("radio B", CLI_SIM_B_CSN_PIN, &sim_b), CLI_SIM_INIT_TRANSACTIONS);
+
+    failures += cc1101_sim_exchange(&a, &b, 24);
+    cc1101_sim_report("sender", CLI_SIM_A_CSN_PIN, &sim_a);
+    cc1101_sim_report("receiver", CLI_SIM_B_CSN_PIN, &sim_b);
+
+    // Larger than the FIFO: both sides stream
+    iohub_cc1101_set_reg(&a, 0x06, 0xFF);
+    iohub_cc1101_set_reg(&b, 0x06, 0xFF);
+    iohub_cc1101_flush_regs(&a);
+    iohub_cc1101_flush_regs(&b);
+    iohub_linux_spi_reset_stats(CLI_SIM_A_CSN_PIN);
+    iohub_linux_spi_reset_stats(CLI_SIM_B_CSN_PIN);
+    memset(&sim_a.mStats, 0x00, sizeof(sim_a.mStats));
+    memset(&sim_b.mStats, 0x00, sizeof(sim_b.mStats));
+
+    failures += cc1101_sim_exchange(&a, &b, 200);
+    cc1101_sim_report("sender", CLI_SIM_A_CSN_PIN, &sim_a);
+    cc1101_sim_report("receiver", CLI_SIM_B_CSN_PIN, &sim_b);
+
+    // Same packet paced by GDO2: TX FIFO threshold on the sender, RX threshold / end of packet on the receiver
+    iohub_cc1101_sim_set_gdo2_pin(&sim_a, CLI_SIM_A_GDO2_PIN);
+    iohub_cc1101_sim_set_gdo2_pin(&sim_b, CLI_SIM_B_GDO2_PIN);
+    iohub_cc1101_set_gdo2_pin(&a, CLI_SIM_A_GDO2_PIN);
+    iohub_cc1101_set_gdo2_pin(&b, CLI_SIM_B_GDO2_PIN);
+    iohub_cc1101_set_reg(&a, 0x00, 0x02);
+    iohub_cc1101_set_reg(&a, 0x03, (a.mRegs[0x03] & 0xF0) | 0x07);
+    iohub_cc1101_set_reg(&b, 0x00, 0x00);
+    iohub_cc1101_set_reg(&b, 0x03, (b.mRegs[0x03] & 0xF0) | 0x07);
+    iohub_cc1101_flush_regs(&a);
+    iohub_cc1101_flush_regs(&b);
+    cc1101_sim_report("(reset)", CLI_SIM_A_CSN_PIN, &sim_a);
+    cc1101_sim_report("(reset)", CLI_SIM_B_CSN_PIN, &sim_b);
+
+    failures += cc1101_sim_exchange(&a, &b, 200);
+    cc1101_sim_report("sender", CLI_SIM_A_CSN_PIN, &sim_a);
+    cc1101_sim_report("receiver", CLI_SIM_B_CSN_PIN, &sim_b);
+
+    // GDO2 as sync word / end of packet: one pulse per packet
+    iohub_cc1101_set_reg(&b, 0x00, 0x06);
+    iohub_cc1101_flush_regs(&b);
+    iohub_attach_interrupt(CLI_SIM_B_GDO2_PIN, cc1101_sim_gdo2_edge, IOHUB_GPIO_INT_TYPE_CHANGE, NULL);
+    sSimGDO2Edges = 0;
+    failures += cc1101_sim_exchange(&a, &b, 24);
+    iohub_detach_interrupt(CLI_SIM_B_GDO2_PIN);
+    printf("  GDO2 sync/end edges: %u\n", sSimGDO2Edges);
+    if (sSimGDO2Edges != 2)
+        failures++;
+    iohub_cc1101_set_reg(&b, 0x00, 0x00);
+    iohub_cc1101_flush_regs(&b);
+
+    // Listen before talk: the channel is busy for 2 assessments, then for more than the budget
+    cc1101_cca_settings cca = { 3, 0, 0, 3, 100, 1000 };
+    cc1101_tx_report report;
+
+    iohub_cc1101_set_cca(&a, &cca);
+    iohub_cc1101_sim_set_channel_busy(&sim_a, 2);
+    failures += cc1101_sim_exchange(&a, &b, 24);
+    iohub_cc1101_get_tx_report(&a, &report);
+    printf("  CCA: sent=%d backoffs=%u (%lu us)\n", report.mfSent, report.mBackoffCount, report.mBackoffUs);
+    if (!report.mfSent || report.mBackoffCount != 2)
+        failures++;
+
+    iohub_cc1101_sim_set_channel_busy(&sim_a, 10);
+    cc1101_packet_ctx packet;
+    packet.mDst = 0x00;
+    packet.mLength = 4;
+    memset(packet.mData, 0x55, packet.mLength);
+    int ret = iohub_cc1101_send_data(&a, &packet);
+    iohub_cc1101_get_tx_report(&a, &report);
+    printf("  CCA busy: ret=%d sent=%d backoffs=%u\n", ret, report.mfSent, report.mBackoffCount);
+    if (ret != E_TIMEOUT || report.mfSent || report.mBackoffCount != cca.mMaxBackoffs)
+        failures++;
+
+    iohub_cc1101_sim_set_channel_busy(&sim_a, 0);
+    iohub_cc1101_set_cca(&a, NULL);
+
+    // Hardware filtering on the receiver: other addresses and long packets never reach the FIFO
+    cc1101_filter filter = { CC1101AddressCheck_Broadcast00, 0x42, FALSE, 32 };
+    cc1101_filter_stats filter_stats;
+    static const u8 filter_dst[] = { 0x42, 0x17, 0x00, 0x42 };
+    static const u8 filter_len[] = { 10, 10, 10, 40 };
+    int delivered = 0;
+
+    iohub_cc1101_set_filter(&b, &filter);
+    iohub_cc1101_reset_filter_stats(&b);
+    filter.mfCrcAutoFlush = TRUE;
+    if (iohub_cc1101_set_filter(&b, &filter) != E_NOT_SUPPORTED) // No CRC in this configuration
+        failures++;
+
+    iohub_cc1101_wakeup(&b);
+    iohub_cc1101_set_receive(&b);
+    for (unsigned i = 0; i < sizeof(filter_dst); ++i) {
+        cc1101_packet_ctx rx;
+        packet.mDst = filter_dst[i];
+        packet.mLength = filter_len[i];
+        iohub_cc1101_send_data(&a, &packet);
+        if (iohub_cc1101_receive_data_timeout(&b, &rx, 20) == SUCCESS && rx.mLength > 0)
+            delivered++;
+    }
+    iohub_cc1101_standby(&b);
+
+    iohub_cc1101_get_filter_stats(&b, &filter_stats);
+    printf("  filter: delivered=%lu dropped=%lu (chip %lu)\n", filter_stats.mDelivered, filter_stats.mDropped,
+           sim_b.mStats.mPacketFilteredCount);
+    if (delivered != 2 || filter_stats.mDelivered != 2 || filter_stats.mDropped != 2)
+        failures++;
+
+    // Sweep wider than the calibration cache: only the first pass calibrates
+    s16 scan_rssi[64];
+    cc1101_sim_report("(reset)", CLI_SIM_A_CSN_PIN, &sim_a);
+    for (int pass = 0; pass < 2; ++pass) {
+        ret = iohub_cc1101_scan(&a, 0, sizeof(scan_rssi) / sizeof(scan_rssi[0]), 0, scan_rssi, NULL);
+        printf("  scan pass %d: ret=%d calibrations=%lu\n", pass + 1, ret, sim_a.mStats.mCalibrationCount);
+        if (ret != SUCCESS || (pass > 0 && sim_a.mStats.mCalibrationCount != 0))
+            failures++;
+        cc1101_sim_report("scanner", CLI_SIM_A_CSN_PIN, &sim_a);
+    }
+
+    // Repeated frame: send_data() in a loop vs one send_repeat(), back to back then with a gap
+    packet.mDst = 0x42;
+    packet.mLength = 10;
+    cc1101_sim_report("(reset)", CLI_SIM_A_CSN_PIN, &sim_a);
+    for (int i = 0; i < 5; ++i)
+        iohub_cc1101_send_data(&a, &packet);
+    printf("  5 x send_data: sent=%lu\n", sim_a.mStats.mPacketSentCount);
+    u32 loop_transactions = cc1101_sim_report("sender", CLI_SIM_A_CSN_PIN, &sim_a);
+
+    static const u32 repeat_gap_us[] = { 0, 2000 };
+    for (unsigned i = 0; i < 2; ++i) {
+        ret = iohub_cc1101_send_repeat(&a, &packet, 5, repeat_gap_us[i]);
+        iohub_cc1101_get_tx_report(&a, &report);
+        printf("  send_repeat x5 gap %lu us: ret=%d frames=%u sent=%lu\n", repeat_gap_us[i], ret, report.mFrameCount,
+               sim_a.mStats.mPacketSentCount);
+        if (ret != SUCCESS || report.mFrameCount != 5 || sim_a.mStats.mPacketSentCount != 5)
+            failures++;
+        // At least twice cheaper than the loop it replaces
+        failures += cc1101_sim_budget("send_repeat", cc1101_sim_report("sender", CLI_SIM_A_CSN_PIN, &sim_a), loop_transactions / 2);
+    }
+
+    // Process restart while radio B receives: warm init keeps it in RX, a changed configuration resets it
+    u8 config[CC1101_REGISTERS_COUNT];
+    cc1101_ctx b2;
+    BOOL resumed;
+
+    memcpy(config, b.mRegs, sizeof(config));
+    iohub_cc1101_wakeup(&b);
+    iohub_cc1101_set_receive(&b);
+    cc1101_sim_report("(reset)", CLI_SIM_B_CSN_PIN, &sim_b);
+
+    ret = iohub_cc1101_init_warm(&b2, CLI_SIM_B_CSN_PIN, CLI_SIM_B_GDO0_PIN, config, CC1101_PATABLE_FIRSTBYTE, &resumed);
+    printf("  warm init: ret=%d resumed=%d in %lu us\n", ret, resumed, b2.mInitTimeUs);
+    failures += cc1101_sim_budget("warm init", cc1101_sim_report("receiver", CLI_SIM_B_CSN_PIN, &sim_b), CLI_SIM_WARM_INIT_TRANSACTIONS);
+
+    cc1101_packet_ctx rx;
+    iohub_cc1101_send_data(&a, &packet);
+    int warm_ret = iohub_cc1101_receive_data_timeout(&b2, &rx, 20);
+    printf("  warm init: packet ret=%d (%u bytes)\n", warm_ret, rx.mLength);
+    iohub_cc1101_standby(&b2);
+    if (ret != SUCCESS || !resumed || warm_ret != SUCCESS || rx.mLength != packet.mLength)
+        failures++;
+
+    iohub_cc1101_uninit(&b2);
+    ret = iohub_cc1101_init_warm(&b2, CLI_SIM_B_CSN_PIN, CLI_SIM_B_GDO0_PIN, sC1101SauterConfig, CC1101_PATABLE_FIRSTBYTE, &resumed);
+    printf("  warm init, other configuration: ret=%d resumed=%d in %lu us\n", ret, resumed, b2.mInitTimeUs);
+    cc1101_sim_report("receiver", CLI_SIM_B_CSN_PIN, &sim_b);
+    if (ret != SUCCESS || resumed)
+        failures++;
+    iohub_cc1101_uninit(&b2);
+
+    iohub_cc1101_dump_transition_stats(&a);
+    iohub_cc1101_dump_transition_stats(&b);
+
+    iohub_cc1101_uninit(&a);
+    iohub_cc1101_sim_uninit(&sim_a);
+    iohub_cc1101_sim_uninit(&sim_b);
+
+    return failures == 0;
+}
+
+#endif
+
 /* --------------------------------------------------------------------------------------------
                                    INOVALLEY WEATHER STATION
    -------------------------------------------------------------------------------------------- */
@@ -95,22 +433,28 @@ static void cc1101_listen(void)
 static void inovalley_listen(void)
 {
     rs8706w_weatherlink_data data;
-    rs8706w_weatherlink_ctx ctx;
+    rs8706w_weatherlink ctx;
+    digital_async_receiver receiver;
 
-    if (iohub_rs8706w_weatherlink_init(&ctx, 0) != SUCCESS) {
+    if (iohub_rs8706w_weatherlink_init(&ctx) != SUCCESS) {
         fprintf(stderr, "Weatherlink init failed\n");
         return;
     }
 
+    iohub_digital_async_receiver_init(&receiver, CLI_RX_PIN);
+    iohub_digital_async_receiver_register(&receiver, iohub_rs8706w_weatherlink_get_interface(), &ctx);
+    iohub_digital_async_receiver_start(&receiver);
+
     for (;;) {
-        int ret = iohub_rs8706w_weatherlink_read(&ctx, 60 * 1000, &data);
-        if (ret == SUCCESS) {
-            printf("WeatherStation: %.1f°C %lu mm\n",
-                   data.mTemperatureCelsius / 10.0f,
+        u16 receiverId = iohub_digital_async_receiver_wait_for_packet(&receiver);
+        if (iohub_rs8706w_weatherlink_read(&ctx, &data)) {
+            printf("WeatherStation: %.1f°C %u mm\n",
+                   data.mTemperatureCelsius,
                    data.mRainfallMillimeters);
         } else {
-            fprintf(stderr, "WeatherStation error: %d\n", ret);
+            fprintf(stderr, "WeatherStation: invalid packet\n");
         }
+        iohub_digital_async_receiver_packet_handled(&receiver, receiverId);
     }
 }
 
@@ -118,33 +462,218 @@ static void inovalley_listen(void)
                                         DIO
    -------------------------------------------------------------------------------------------- */
 
-static void dio_send(unsigned long sender, unsigned short interruptor)
+static void dio_send(int on, unsigned long sender, unsigned short interruptor)
 {
-    chacon_dio_ctx ctx;
-    iohub_chacon_dio_init(&ctx, 0, ChaconDioMode_Send);
-    iohub_chacon_dio_send_command(&ctx, 1, sender, interruptor & 0xFF);
+    chacon_dio ctx;
+    iohub_chacon_dio_init(&ctx, CLI_TX_PIN);
+    iohub_chacon_dio_send(&ctx, on, sender, interruptor & 0xFF);
     iohub_chacon_dio_uninit(&ctx);
 }
 
-static void dio_listen(void)
+// use_cc1101: demodulated by a CC1101 in asynchronous serial mode (GDO2) instead of the RX module
+static void dio_listen(bool use_cc1101)
 {
-    chacon_dio_ctx ctx;
-    if (iohub_chacon_dio_init(&ctx, 0, ChaconDioMode_Recv) != SUCCESS) {
+    chacon_dio ctx;
+    digital_async_receiver receiver;
+    cc1101_ctx cc1101;
+    static cc1101_profile ook;
+
+    if (iohub_chacon_dio_init(&ctx, IOHUB_GPIO_PIN_INVALID) != SUCCESS) {
         fprintf(stderr, "DIO init failed\n");
         return;
     }
 
+    iohub_digital_async_receiver_init(&receiver, use_cc1101 ? CLI_CC1101_GDO2_PIN : CLI_RX_PIN);
+    iohub_digital_async_receiver_register(&receiver, iohub_chacon_dio_get_interface(), &ctx);
+
+    if (!use_cc1101) {
+        iohub_digital_async_receiver_start(&receiver);
+    } else {
+        if (iohub_cc1101_init(&cc1101, CLI_CC1101_CSN_PIN, CLI_CC1101_GDO0_PIN, sC1101SauterConfig, CC1101_PATABLE_FIRSTBYTE) != SUCCESS) {
+            fprintf(stderr, "CC1101 init failed\n");
+            return;
+        }
+
+        iohub_cc1101_set_gdo2_pin(&cc1101, CLI_CC1101_GDO2_PIN);
+        iohub_cc1101_profile_compile(&ook, "ook", sC1101SauterConfig, sC1101OokConfig);
+
+        int ret = iohub_cc1101_async_receive_begin(&cc1101, &ook, &receiver);
+        if (ret != SUCCESS) {
+            fprintf(stderr, "CC1101 asynchronous receive failed: %d\n", ret);
+            return;
+        }
+    }
+
     for (;;) {
-        unsigned long sender;
-        unsigned char interruptor;
-        unsigned char on;
-        if (iohub_chacon_dio_recv_command(&ctx, &sender, &interruptor, &on)) {
+        u32 sender;
+        u8 interruptor;
+        BOOL on;
+        u16 receiverId = iohub_digital_async_receiver_wait_for_packet(&receiver);
+        if (iohub_chacon_dio_read(&ctx, &sender, &interruptor, &on)) {
             printf("Received from %lu to %u -> %s\n",
                    sender, interruptor, on ? "ON" : "OFF");
         }
+        iohub_digital_async_receiver_packet_handled(&receiver, receiverId);
     }
 }
 
+/* --------------------------------------------------------------------------------------------
+                                        GPIO BENCHMARK
+   -------------------------------------------------------------------------------------------- */
+
+#define CLI_GPIO_BENCH_BATCHES      200
+#define CLI_GPIO_BENCH_TOGGLES      10000
+
+static int compare_u32(const void *a, const void *b)
+{
+    u32 va = *(const u32 *)a, vb = *(const u32 *)b;
+    return (va > vb) - (va < vb);
+}
+
+static void gpio_bench_report(const char *name, u32 *batch_us)
+{
+    qsort(batch_us, CLI_GPIO_BENCH_BATCHES, sizeof(u32), compare_u32);
+
+    double median_ns = batch_us[CLI_GPIO_BENCH_BATCHES / 2] * 1000.0 / CLI_GPIO_BENCH_TOGGLES;
+    double p99_ns = batch_us[(CLI_GPIO_BENCH_BATCHES * 99) / 100] * 1000.0 / CLI_GPIO_BENCH_TOGGLES;
+    double max_ns = batch_us[CLI_GPIO_BENCH_BATCHES - 1] * 1000.0 / CLI_GPIO_BENCH_TOGGLES;
+
+    printf("%-10s %10.0f toggles/s  median=%7.1f ns  p99=%7.1f ns  max=%7.1f ns  jitter(p99-median)=%7.1f ns\n",
+           name, median_ns > 0 ? 1e9 / median_ns : 0, median_ns, p99_ns, max_ns, p99_ns - median_ns);
+}
+
+    // Compare the generic write path with the fast GPIO handle.
+    // Toggles are timed by batches since one edge is below the timer resolution.
+static void gpio_bench(unsigned pin)
+{
+    static u32 batch_us[CLI_GPIO_BENCH_BATCHES];
+    iohub_fast_gpio gpio;
+
+    iohub_digital_set_pin_mode(pin, PinMode_Output);
+    iohub_fast_gpio_init(&gpio, pin);
+
+    iohub_set_real_time(1);
+
+    for (int b = 0; b < CLI_GPIO_BENCH_BATCHES; ++b) {
+        u32 start = (u32)iohub_time_now_us();
+        for (int t = 0; t < CLI_GPIO_BENCH_TOGGLES / 2; ++t) {
+            iohub_digital_write(pin, PinLevel_High);
+            iohub_digital_write(pin, PinLevel_Low);
+        }
+        batch_us[b] = (u32)iohub_time_now_us() - start;
+    }
+    gpio_bench_report("generic", batch_us);
+
+    for (int b = 0; b < CLI_GPIO_BENCH_BATCHES; ++b) {
+        u32 start = (u32)iohub_time_now_us();
+        for (int t = 0; t < CLI_GPIO_BENCH_TOGGLES / 2; ++t) {
+            iohub_fast_gpio_set(&gpio);
+            iohub_fast_gpio_clear(&gpio);
+        }
+        batch_us[b] = (u32)iohub_time_now_us() - start;
+    }
+    gpio_bench_report("fast_gpio", batch_us);
+
+    iohub_set_real_time(0);
+}
+
+/* --------------------------------------------------------------------------------------------
+                                        TX TIMING
+   -------------------------------------------------------------------------------------------- */
+
+#ifdef IOHUB_TX_TIMING
+
+static BOOL tx_timing_check(const char *name, unsigned long tolerance_us)
+{
+    tx_timing_report report;
+    BOOL ok = TRUE;
+
+    iohub_tx_timing_stop();
+    iohub_tx_timing_analyze(&report);
+
+    printf("%s:\n", name);
+    for (u8 i = 0; i < report.mSymbolCount; ++i) {
+        const tx_timing_symbol *symbol = &report.mSymbols[i];
+        BOOL symbol_ok = (symbol->mP99ErrorUs <= tolerance_us);
+
+        printf("  %s %6lu us  count=%3u  mean=%+5ld us  p99=%5lu us  max=%5lu us  %s\n",
+               symbol->mLevel == PinLevel_High ? "HIGH" : "LOW ",
+               symbol->mExpectedUs, symbol->mCount, symbol->mMeanErrorUs,
+               symbol->mP99ErrorUs, symbol->mMaxErrorUs, symbol_ok ? "OK" : "FAIL");
+
+        ok &= symbol_ok;
+    }
+
+    if (report.mfOverflow) {
+        printf("  Edge buffer overflow, increase IOHUB_TX_TIMING_MAX_EDGES\n");
+        ok = FALSE;
+    }
+
+    return ok;
+}
+
+#ifdef IOHUB_PLATFORM_MPSSE
+    // Edges are recorded while the waveform is compiled, the pulse widths only hold if the
+    // bitbang plays samples at the rate they were compiled for
+static BOOL tx_waveform_rate_check(void)
+{
+    unsigned long rate_hz = iohub_fast_gpio_waveform_rate_hz();
+    unsigned long expected_hz = IOHUB_MPSSE_WAVEFORM_SAMPLE_RATE_HZ;
+    BOOL ok = (rate_hz * 100 >= expected_hz * (100 - CLI_TX_WAVEFORM_RATE_PCT) &&
+               rate_hz * 100 <= expected_hz * (100 + CLI_TX_WAVEFORM_RATE_PCT));
+
+    printf("waveform: %lu samples/s measured, %lu expected  %s\n", rate_hz, expected_hz, ok ? "OK" : "FAIL");
+    return ok;
+}
+#endif
+
+    // Measure pulse widths produced by each bit-banged transmitter
+    // Returns FALSE when one symbol p99 error is above tolerance
+static BOOL tx_timing(unsigned long tolerance_us)
+{
+    BOOL ok = TRUE;
+    chacon_dio chacon;
+    light_seamaid seamaid;
+    heatpump_midea midea;
+    digital_async_receiver receiver;
+    IoHubHeatpumpSettings settings = { HeatpumpAction_ON, 24, HeatpumpFanSpeed_Auto, HeatpumpMode_Heat, HeatpumpVaneMode_Auto };
+
+    iohub_set_real_time(1);
+#ifdef IOHUB_PLATFORM_LINUX
+    // Host scheduling noise is not the transmitters fault, delays advance a virtual clock instead
+    iohub_linux_time_set_virtual(TRUE);
+#endif
+
+    iohub_chacon_dio_init(&chacon, CLI_TX_PIN);
+    iohub_tx_timing_start();
+    iohub_chacon_dio_send(&chacon, TRUE, 0x1234567, 0x05);
+    ok &= tx_timing_check("chacon_dio", tolerance_us);
+
+    iohub_light_seamaid_init(&seamaid, CLI_TX_PIN);
+    iohub_tx_timing_start();
+    iohub_light_seamaid_send(&seamaid, 0x800E, LightSeamaidCmd_ON);
+    ok &= tx_timing_check("light_seamaid", tolerance_us);
+
+    iohub_digital_async_receiver_init(&receiver, CLI_RX_PIN);
+    iohub_heatpump_midea_init(&midea, &receiver, CLI_TX_PIN);
+    iohub_tx_timing_start();
+    iohub_heatpump_midea_set_state(&midea, &settings);
+    ok &= tx_timing_check("heatpump_midea", tolerance_us);
+
+#ifdef IOHUB_PLATFORM_MPSSE
+    ok &= tx_waveform_rate_check();
+#endif
+
+#ifdef IOHUB_PLATFORM_LINUX
+    iohub_linux_time_set_virtual(FALSE);
+#endif
+    iohub_set_real_time(0);
+
+    return ok;
+}
+
+#endif
+
 /* --------------------------------------------------------------------------------------------
                                         MAIN
    -------------------------------------------------------------------------------------------- */
@@ -155,20 +684,32 @@ static void print_help(const char *prog)
     printf("Options:\n");
     printf("  -on <pin>              Set pin HIGH\n");
     printf("  -off <pin>             Set pin LOW\n");
+    printf("  -gpiobench <pin>       Benchmark generic vs fast GPIO toggle rate and jitter\n");
     printf("  -lcd <line1\\nline2>    Write to LCD (2 lines)\n");
     printf("  -lcdbacklight <0|1>    Enable/disable LCD backlight\n");
     printf("  -cc1101send            Send CC1101 test packet\n");
     printf("  -cc1101listen          Listen for CC1101 packets\n");
+    printf("  -cc1101scan <f> <n>    RSSI waterfall over n channels from f\n");
+#ifdef IOHUB_PLATFORM_LINUX
+    printf("  -cc1101sim             Run the CC1101 driver against simulated radios, exit code 1 on failure\n");
+#endif
     printf("  -dio <on|off>          Control DIO output\n");
     printf("  -diosender <id>        Specify sender ID\n");
     printf("  -diointerruptor <id>   Specify interruptor ID\n");
     printf("  -diolisten             Listen to DIO commands\n");
+    printf("  -cc1101diolisten       Listen to DIO commands through the CC1101 (OOK, data on GDO2)\n");
     printf("  -inovalley             Listen to weather station data\n");
+#ifdef IOHUB_TX_TIMING
+    printf("  -txtolerance <us>      Max p99 pulse error accepted by -txtiming (default: %d)\n", CLI_TX_TIMING_TOLERANCE_US);
+    printf("  -txtiming              Measure transmitters pulse timings, exit code 1 if above tolerance\n");
+#endif
     printf("  -h                     Show this help\n");
 }
 
 int main(int argc, char *argv[])
 {
+    iohub_platform_init();
+
     if (argc < 2) {
         print_help(argv[0]);
         return 0;
@@ -177,6 +718,9 @@ int main(int argc, char *argv[])
     int lcd_backlight = 1;
     unsigned long dio_sender = 0xFF;
     unsigned short dio_interruptor = 0x01;
+#ifdef IOHUB_TX_TIMING
+    unsigned long tx_tolerance_us = CLI_TX_TIMING_TOLERANCE_US;
+#endif
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "-h") == 0) {
@@ -184,14 +728,14 @@ int main(int argc, char *argv[])
             return 0;
         } else if (strcmp(argv[i], "-on") == 0 && i + 1 < argc) {
             unsigned pin = (unsigned)strtoul(argv[++i], NULL, 0);
-            digital_ctx ctx;
-            iohub_digital_init(&ctx, pin, PinMode_Output);
-            iohub_digital_write(&ctx, PinLevel_High);
+            iohub_digital_set_pin_mode(pin, PinMode_Output);
+            iohub_digital_write(pin, PinLevel_High);
         } else if (strcmp(argv[i], "-off") == 0 && i + 1 < argc) {
             unsigned pin = (unsigned)strtoul(argv[++i], NULL, 0);
-            digital_ctx ctx;
-            iohub_digital_init(&ctx, pin, PinMode_Output);
-            iohub_digital_write(&ctx, PinLevel_Low);
+            iohub_digital_set_pin_mode(pin, PinMode_Output);
+            iohub_digital_write(pin, PinLevel_Low);
+        } else if (strcmp(argv[i], "-gpiobench") == 0 && i + 1 < argc) {
+            gpio_bench((unsigned)strtoul(argv[++i], NULL, 0));
         } else if (strcmp(argv[i], "-lcd") == 0 && i + 1 < argc) {
             const char *text = argv[++i];
             if (i + 1 < argc && strcmp(argv[i + 1], "-lcdbacklight") == 0)
@@ -201,19 +745,36 @@ int main(int argc, char *argv[])
             cc1101_send();
         } else if (strcmp(argv[i], "-cc1101listen") == 0) {
             cc1101_listen();
+        } else if (strcmp(argv[i], "-cc1101scan") == 0 && i + 2 < argc) {
+            unsigned first = (unsigned)strtoul(argv[++i], NULL, 0);
+            cc1101_scan(first, (unsigned)strtoul(argv[++i], NULL, 0));
         } else if (strcmp(argv[i], "-dio") == 0 && i + 1 < argc) {
             const char *state = argv[++i];
             int on = (strcmp(state, "on") == 0);
-            dio_send(dio_sender, dio_interruptor);
+            dio_send(on, dio_sender, dio_interruptor);
             printf("Sent DIO %s\n", on ? "ON" : "OFF");
         } else if (strcmp(argv[i], "-diosender") == 0 && i + 1 < argc) {
             dio_sender = strtoul(argv[++i], NULL, 0);
         } else if (strcmp(argv[i], "-diointerruptor") == 0 && i + 1 < argc) {
             dio_interruptor = (unsigned short)strtoul(argv[++i], NULL, 0);
         } else if (strcmp(argv[i], "-diolisten") == 0) {
-            dio_listen();
+            dio_listen(false);
+        } else if (strcmp(argv[i], "-cc1101diolisten") == 0) {
+            dio_listen(true);
         } else if (strcmp(argv[i], "-inovalley") == 0) {
             inovalley_listen();
+#ifdef IOHUB_PLATFORM_LINUX
+        } else if (strcmp(argv[i], "-cc1101sim") == 0) {
+            if (!cc1101_sim_check())
+                return 1;
+#endif
+#ifdef IOHUB_TX_TIMING
+        } else if (strcmp(argv[i], "-txtolerance") == 0 && i + 1 < argc) {
+            tx_tolerance_us = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-txtiming") == 0) {
+            if (!tx_timing(tx_tolerance_us))
+                return 1;
+#endif
         }
     }
 
@@ -32,4 +32,13 @@ function(configure_iohub_target TARGET_NAME PLATFORM_NAME)
         set_property(TARGET ${TARGET_NAME} PROPERTY C_STANDARD 11)
         set_property(TARGET ${TARGET_NAME} PROPERTY C_STANDARD_REQUIRED ON)
     endif()
+
+    # Optional transmit timing instrumentation (see utils/iohub_tx_timing.h)
+    if(IOHUB_TX_TIMING)
+        if(TARGET_TYPE STREQUAL "INTERFACE_LIBRARY")
+            target_compile_definitions(${TARGET_NAME} INTERFACE IOHUB_TX_TIMING=1)
+        else()
+            target_compile_definitions(${TARGET_NAME} PUBLIC IOHUB_TX_TIMING=1)
+        endif()
+    endif()
 endfunction()
\ No newline at end of file
@@ -32,38 +32,270 @@ PINOUT CC1101 868: https://quadmeup.com/wp-content/uploads/2017/12/CC1101-868mhz
 	D03		| 6 (GD2)
 	3v3		| 1 (VCC)
 	GND		| 2 (Gnd)
+
+Several radios (e.g. 433 MHz and 868 MHz) share SCK / MOSI / MISO, each one with its own CSn and
+GDO pins and its own cc1101_ctx. Nothing in the driver is global: the GDO0 interrupt gets its
+cc1101_ctx back as argument, and the platform SPI layer hands the bus to one CSn at a time, for
+one transaction: a radio draining its FIFO never holds the bus for more than one burst.
 */
 
 #include "utils/iohub_types.h"
+#include "platform/iohub_platform.h"
 #include "platform/iohub_spi.h"
+#include "utils/iohub_digital_async_receiver.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#define CC1101_BUFFER_LEN        64
-#define CC1101_DATA_LEN          (CC1101_BUFFER_LEN - 3)
+#define CC1101_BUFFER_LEN        64		//TX and RX FIFO size
+
+	//Largest packet in variable length mode (length byte), bigger ones go through iohub_cc1101_send_long()
+#ifndef CC1101_PACKET_MAX_LEN
+#	define CC1101_PACKET_MAX_LEN    255
+#endif
+
+#define CC1101_DATA_LEN          (CC1101_PACKET_MAX_LEN - 1) //The length byte also counts mDst
+
+	//Per channel FSCAL3/2/1 results, direct mapped on the channel number and base frequency
+#ifndef CC1101_FSCAL_CACHE_SIZE
+#	define CC1101_FSCAL_CACHE_SIZE		16
+#endif
+
+	//Channels with their own calibration slot during iohub_cc1101_scan(), sweeps wider than the cache would evict
+	//their own entries on every pass. 0 makes the scan go through the cache (small RAM targets)
+#ifndef CC1101_SCAN_FSCAL_CHANNELS
+#	ifdef ARDUINO
+#		define CC1101_SCAN_FSCAL_CHANNELS	0
+#	else
+#		define CC1101_SCAN_FSCAL_CHANNELS	256
+#	endif
+#endif
+
+	//Calibration results are only reused within the same temperature bucket
+#ifndef CC1101_FSCAL_TEMP_BUCKET_C
+#	define CC1101_FSCAL_TEMP_BUCKET_C	10
+#endif
 
 /* -------------------------------------------------------------- */
 
 typedef struct cc1101_packet_ctx_s
 {
-    u8      mLength;
+    u8      mLength;		//Bytes in mData, the length byte on air is mLength + 1
 	u8		mDst;
     u8      mData[CC1101_DATA_LEN];
 	
     BOOL    mfCrcOk;
     u8      mRSSI;
     u8      mLinkQualityIndex;
+
+	uint64_t	mTimeUs;	//Reception time, end of packet (GDO0) when available, FIFO read otherwise
 }cc1101_packet_ctx;
 
 /* -------------------------------------------------------------- */
 
+struct cc1101_ctx_s;
+
+	//Called from iohub_cc1101_process() (task context), never from the ISR
+typedef void (*cc1101_rx_callback)(struct cc1101_ctx_s *aCtx, cc1101_packet_ctx *aPacket, void *anArg);
+
+typedef struct cc1101_fscal_entry_s
+{
+	BOOL	mfValid;
+	u8		mChannel;
+	u32		mFreq;			//FREQ2:FREQ1:FREQ0, profiles may use other base frequencies
+	s8		mTempBucket;
+	u8		mFscal[3];		//FSCAL3, FSCAL2, FSCAL1
+}cc1101_fscal_entry;
+
+#if CC1101_SCAN_FSCAL_CHANNELS > 0
+	//Indexed by channel number, valid for one base frequency / temperature bucket
+typedef struct cc1101_scan_fscal_s
+{
+	u32		mFreq;
+	s8		mTempBucket;
+	u8		mValid[(CC1101_SCAN_FSCAL_CHANNELS + 7) / 8];
+	u8		mFscal[CC1101_SCAN_FSCAL_CHANNELS][3];
+}cc1101_scan_fscal;
+#endif
+
+/* -------------------------------------------------------------- */
+
+	//Worst case: every other register changed, 2 bytes header per range
+#define CC1101_PROFILE_BLOB_MAX		(CC1101_REGISTERS_COUNT * 2 + 2)
+
+	//Registers differing from mBase, as [start][count][values...] ranges
+typedef struct cc1101_profile_s
+{
+	const char	*mName;
+	const u8	*mBase;			//Full table, must outlive the profile
+	u8			mBlob[CC1101_PROFILE_BLOB_MAX];
+	u8			mBlobLen;
+}cc1101_profile;
+
+/* -------------------------------------------------------------- */
+
+	//PKTCTRL1.ADR_CHK, the address is the byte after the length byte (mDst)
+typedef enum
+{
+	CC1101AddressCheck_None = 0,
+	CC1101AddressCheck_Exact,				//ADDR only
+	CC1101AddressCheck_Broadcast00,			//ADDR and 0x00
+	CC1101AddressCheck_Broadcast00FF		//ADDR, 0x00 and 0xFF
+}CC1101AddressCheck;
+
+	//Packets the chip drops by itself, the host never reads them out
+typedef struct cc1101_filter_s
+{
+	CC1101AddressCheck	mAddressCheck;
+	u8					mAddress;			//ADDR
+	BOOL				mfCrcAutoFlush;		//PKTCTRL1.CRC_AUTOFLUSH, needs PKTCTRL0.CRC_EN and packets fitting the FIFO
+	u8					mMaxLength;			//PKTLEN in variable length mode, longer packets are dropped
+}cc1101_filter;
+
+typedef struct cc1101_filter_stats_s
+{
+	u32		mDelivered;				//Packets read from the RX FIFO
+	u32		mDropped;				//End of packet (GDO0) without data: address, length or CRC filtering, the chip does not tell which
+	u32		mCrcErrors;				//Read with a bad CRC, CRC_AUTOFLUSH off
+}cc1101_filter_stats;
+
+/* -------------------------------------------------------------- */
+
+	//Listen before talk, see iohub_cc1101_set_cca()
+typedef struct cc1101_cca_settings_s
+{
+	u8		mMode;					//MCSM1.CCA_MODE: 1 = RSSI below threshold, 2 = not receiving a packet, 3 = both
+	u8		mRelativeThreshold;		//AGCCTRL1.CARRIER_SENSE_REL_THR: 0 = off, 1 / 2 / 3 = RSSI increase of 6 / 10 / 14 dB
+	s8		mAbsoluteThreshold;		//AGCCTRL1.CARRIER_SENSE_ABS_THR, dB from MAGN_TARGET: -7..7, -8 = off
+	u8		mMaxBackoffs;			//Retry budget, the send is given up after that many busy channel assessments
+	u16		mBackoffMinUs;			//First random backoff window, doubled at each retry...
+	u16		mBackoffMaxUs;			//...up to this one
+}cc1101_cca_settings;
+
+	//Outcome of the last send
+typedef struct cc1101_tx_report_s
+{
+	BOOL	mfSent;
+	u8		mBackoffCount;			//STX refused by the chip because the channel was busy
+	u32		mBackoffUs;				//Random backoff time in total
+	s16		mBusyRssiDbm;			//RSSI at the last refusal
+	u8		mFrameCount;			//Copies on air, see iohub_cc1101_send_repeat()
+}cc1101_tx_report;
+
+/* -------------------------------------------------------------- */
+
+	//Target state of a transition, for the timing statistics
+typedef enum
+{
+	CC1101Transition_Idle = 0,
+	CC1101Transition_Rx,
+	CC1101Transition_Tx,
+	CC1101Transition_FsTxOn,
+	CC1101Transition_Other,
+	CC1101Transition_Count
+}CC1101Transition;
+
+	//Measured from the start of the wait (right after the strobe) until the state is seen
+typedef struct cc1101_transition_stats_s
+{
+	u32			mCount;
+	u32			mTimeoutCount;
+	u32			mEventCount;			//Waits ended by a GDO0 edge rather than polling
+	u32			mPollCount;				//Status / MARCSTATE reads
+	u32			mLastUs;
+	u32			mMinUs;
+	u32			mMaxUs;
+	uint64_t	mTotalUs;
+}cc1101_transition_stats;
+
+/* -------------------------------------------------------------- */
+
+	//Wake-on-Radio timings, from iohub_cc1101_wor_compute()
+typedef struct cc1101_wor_settings_s
+{
+	u16		mEvent0;				//WOREVT1:WOREVT0
+	u8		mWorRes;				//WORCTRL.WOR_RES
+	u8		mRxTime;				//MCSM2.RX_TIME
+
+	u32		mIntervalUs;			//Time between two wake ups
+	u32		mRxTimeoutUs;			//Listen window of each wake up
+	u32		mDutyCyclePpm;
+	u32		mAverageCurrentNa;		//Estimate while no packet comes in
+}cc1101_wor_settings;
+
+/* -------------------------------------------------------------- */
+
 typedef struct cc1101_ctx_s
 {
     spi_ctx             mSPICtx;
     u32        			mGDO0Pin;
+	u32					mGDO2Pin;				//Optional, FIFO threshold signal while streaming
 	s8					mWakeupCount;
+
+	u32					mSPITransactionCount;	//CSn select/deselect cycles issued by the driver
+
+		//Chip status byte returned with every header / strobe
+	u8					mStatus;
+	uint64_t			mStatusTimeUs;
+	BOOL				mfStatusValid;			//FALSE after a strobe: the byte was sampled before the command ran
+	u8					mRxFifoBytes;			//From read accesses, saturates at 15
+	u8					mTxFifoFree;			//From write accesses, saturates at 15
+
+	u32					mInitTimeUs;			//Duration of the last iohub_cc1101_init() / init_warm()
+
+		//Shadow of the configuration registers, valid once init has read them back
+	u8					mRegs[CC1101_REGISTERS_COUNT];
+	uint64_t			mDirtyRegs;				//Bit n set: mRegs[n] changed and not written to the chip yet
+	BOOL				mfRegsValid;
+	u8					mPaTable;
+
+		//GDO0 end of packet (falling edge), only when a GDO0 pin is wired
+	iohub_event			mRxEvent;
+	volatile u8			mRxPendingCount;
+	volatile uint64_t	mRxEventTimeUs;			//Last end of packet edge
+	cc1101_rx_callback	mRxCallback;
+	void				*mRxCallbackArg;
+
+		//Optional ring of received packets, storage provided by the caller
+	cc1101_packet_ctx	*mRxRing;
+	u8					mRxRingSize;
+	u8					mRxRingHead;			//Oldest entry
+	u8					mRxRingCount;
+	u32					mRxRingDropped;			//Packets lost because the ring was full or the FIFO overflowed
+	cc1101_filter_stats	mFilterStats;
+	u8					mRxRingSavedMCSM1;
+
+		//Wake-on-Radio, the radio is held awake (mWakeupCount) while active
+	BOOL				mfWorActive;
+	u8					mWorSavedRegs[5];
+
+		//Calibration cache, when enabled autocal is off and channel switches write the cached FSCAL values
+	cc1101_fscal_entry	mFscalCache[CC1101_FSCAL_CACHE_SIZE];
+	s8					mFscalTempBucket;
+	BOOL				mfFscalCacheEnabled;
+	u8					mFscalSavedMCSM0;
+#if CC1101_SCAN_FSCAL_CHANNELS > 0
+	cc1101_scan_fscal	mScanFscal;				//Filled by the first scan pass, later passes never calibrate
+#endif
+
+	const cc1101_profile	*mProfile;			//Last applied profile
+
+		//Transceiver session: TX and RX return to RX on their own, no autocal
+	BOOL				mfSessionActive;
+	u8					mSessionSavedRegs[2];
+
+	cc1101_transition_stats	mTransitions[CC1101Transition_Count];
+
+		//Listen before talk: STX is issued from RX, the chip ignores it while the channel is busy
+	BOOL				mfCCAEnabled;
+	cc1101_cca_settings	mCCA;
+	u8					mCCASavedRegs[2];
+	u32					mRandomState;			//Backoff draws
+	cc1101_tx_report	mTxReport;
+
+		//Asynchronous serial RX: demodulated data on GDO2, decoded by a digital_async_receiver
+	digital_async_receiver	*mAsyncReceiver;
 }cc1101_ctx;
 
 /* -------------------------------------------------------------- */
@@ -71,16 +303,108 @@ typedef struct cc1101_ctx_s
 ret_code_t     	iohub_cc1101_init(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDefaultConfig[CC1101_REGISTERS_COUNT], u8 aFirstBytePaTable);
 void    		iohub_cc1101_uninit(cc1101_ctx *aCtx);
 
+	//Skips the reset when the chip already holds aDefaultConfig (process restart), *afResumed tells which
+	//path ran. A radio left receiving keeps its FIFO and RX state, with one wakeup held by the context
+ret_code_t     	iohub_cc1101_init_warm(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDefaultConfig[CC1101_REGISTERS_COUNT], u8 aFirstBytePaTable, BOOL *afResumed);
+
 ret_code_t 		iohub_cc1101_wakeup(cc1101_ctx *aCtx);
 ret_code_t 		iohub_cc1101_standby(cc1101_ctx *aCtx);
 
 ret_code_t     	iohub_cc1101_send_data(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket);
 
+	//aCount copies of a packet fitting the FIFO, aGapUs between the end of a copy and the start of the
+	//next one (0 = back to back, preamble only). One wakeup for all, the report tells how many went out
+ret_code_t     	iohub_cc1101_send_repeat(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket, u8 aCount, u32 aGapUs);
+
+	//Infinite length mode, 2 bytes length header, only iohub_cc1101_receive_long() understands these frames
+ret_code_t     	iohub_cc1101_send_long(cc1101_ctx *aCtx, const u8 *aData, u16 aLength);
+
+	//Hardware filtering. filter_to_config() sets the same fields in a register table, so that each
+	//profile (or init configuration) carries its own defaults. Drops are counted from GDO0 edges
+ret_code_t 		iohub_cc1101_set_filter(cc1101_ctx *aCtx, const cc1101_filter *aFilter);
+void 			iohub_cc1101_get_filter(cc1101_ctx *aCtx, cc1101_filter *aFilter);
+ret_code_t 		iohub_cc1101_filter_to_config(const cc1101_filter *aFilter, u8 aConfig[CC1101_REGISTERS_COUNT]);
+void 			iohub_cc1101_get_filter_stats(cc1101_ctx *aCtx, cc1101_filter_stats *aStats);
+void 			iohub_cc1101_reset_filter_stats(cc1101_ctx *aCtx);
+
+	//Clear channel assessment before every send, NULL turns it off. A send still refused after the retry
+	//budget returns E_TIMEOUT, get_tx_report() tells how each send went
+ret_code_t 		iohub_cc1101_set_cca(cc1101_ctx *aCtx, const cc1101_cca_settings *aSettings);
+void 			iohub_cc1101_get_tx_report(cc1101_ctx *aCtx, cc1101_tx_report *aReport);
+ret_code_t     	iohub_cc1101_receive_long(cc1101_ctx *aCtx, u8 *aBuffer, u16 aBufferLen, u16 *aLength, u32 aTimeoutMs);
+
+void 			iohub_cc1101_set_gdo2_pin(cc1101_ctx *aCtx, u32 aGDO2Pin);
+
 ret_code_t		iohub_cc1101_set_receive(cc1101_ctx *aCtx);
 ret_code_t     	iohub_cc1101_receive_data(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket);
+ret_code_t     	iohub_cc1101_receive_data_timeout(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket, u32 aTimeoutMs);
+
+	//Deferred drain: the ISR only flags the packet, process() reads it and calls the callback
+void 			iohub_cc1101_set_rx_callback(cc1101_ctx *aCtx, cc1101_rx_callback aCallback, void *anArg);
+ret_code_t 		iohub_cc1101_process(cc1101_ctx *aCtx);
+
+	//Packet ring: the radio stays in RX between packets (MCSM1.RXOFF_MODE), drain() moves every complete
+	//packet from the FIFO to the ring, dequeue() never touches the radio. aBuffer = NULL disables the ring
+ret_code_t 		iohub_cc1101_set_rx_ring(cc1101_ctx *aCtx, cc1101_packet_ctx *aBuffer, u8 aSize);
+ret_code_t 		iohub_cc1101_rx_drain(cc1101_ctx *aCtx);
+BOOL 			iohub_cc1101_dequeue(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket);
+u8 				iohub_cc1101_rx_count(cc1101_ctx *aCtx);
+
+	//Wake-on-Radio: the senders preamble (aPreambleBytes at the configured data rate) must cover a whole
+	//wake interval. aDutyCyclePpm is rounded down to the closest RX_TIME: 12.5% / 2^n while the interval fits
+	//WOR_RES = 0, longer intervals only offer 1.95% / 2^n (WOR_RES = 1) and 32 times less per further step. Needs GDO0
+ret_code_t 		iohub_cc1101_wor_compute(cc1101_ctx *aCtx, u32 aDutyCyclePpm, u16 aPreambleBytes, cc1101_wor_settings *aSettings);
+ret_code_t 		iohub_cc1101_wor_start(cc1101_ctx *aCtx, const cc1101_wor_settings *aSettings);
+ret_code_t 		iohub_cc1101_wor_stop(cc1101_ctx *aCtx);
+
+	//Transceiver session: the synthesizer is calibrated once, TX ends in RX (MCSM1.TXOFF_MODE) and RX stays in RX.
+	//afListen = FALSE parks the radio in FSTXON (SFSTXON) so the first send starts without settling
+ret_code_t 		iohub_cc1101_session_begin(cc1101_ctx *aCtx, BOOL afListen);
+ret_code_t 		iohub_cc1101_session_end(cc1101_ctx *aCtx);
+
+	//Request / response, inside a session or in a temporary one
+ret_code_t 		iohub_cc1101_transceive(cc1101_ctx *aCtx, cc1101_packet_ctx *aRequest, cc1101_packet_ctx *aResponse, u32 aTimeoutMs);
+
+	//RSSI sweep over aChannelCount channels from aFirstChannel, aDwellUs in RX on each.
+	//aRssiDbm receives one value per channel, aNoiseFloorDbm (optional) their median.
+	//Each channel is calibrated on the first sweep only (see CC1101_SCAN_FSCAL_CHANNELS)
+ret_code_t 		iohub_cc1101_scan(cc1101_ctx *aCtx, u8 aFirstChannel, u8 aChannelCount, u32 aDwellUs, s16 *aRssiDbm, s16 *aNoiseFloorDbm);
+s16 			iohub_cc1101_rssi_to_dbm(u8 aRSSI);
 
 BOOL 			iohub_cc1101_is_data_available(cc1101_ctx *aCtx);
 
+u8 				iohub_cc1101_get_state(cc1101_ctx *aCtx);
+
+	//State transition timings, mean = mTotalUs / mCount
+void 			iohub_cc1101_get_transition_stats(cc1101_ctx *aCtx, CC1101Transition aTransition, cc1101_transition_stats *aStats);
+void 			iohub_cc1101_reset_transition_stats(cc1101_ctx *aCtx);
+void 			iohub_cc1101_dump_transition_stats(cc1101_ctx *aCtx);
+
+	//Register shadow: set/get only touch RAM, flush pushes the changed ranges in burst mode
+void 			iohub_cc1101_set_reg(cc1101_ctx *aCtx, u8 aRegAddr, u8 aValue);
+u8 				iohub_cc1101_get_reg(cc1101_ctx *aCtx, u8 aRegAddr);
+ret_code_t 		iohub_cc1101_flush_regs(cc1101_ctx *aCtx);
+
+	//Frequency synthesizer calibration cache: set_channel() writes FSCAL3/2/1 back in burst instead of calibrating
+ret_code_t 		iohub_cc1101_set_fscal_cache(cc1101_ctx *aCtx, BOOL afEnable);
+ret_code_t 		iohub_cc1101_calibrate_channels(cc1101_ctx *aCtx, const u8 *aChannels, u8 aCount);
+void 			iohub_cc1101_set_temperature(cc1101_ctx *aCtx, s8 aTemperatureC);
+void 			iohub_cc1101_invalidate_fscal(cc1101_ctx *aCtx);
+
+	//Profiles: aTarget is diffed against aBase (0xFF = don't care in both), apply_profile() only writes
+	//the registers that differ from the current configuration, in burst mode, then restores cached calibration
+ret_code_t 		iohub_cc1101_profile_compile(cc1101_profile *aProfile, const char *aName, const u8 aBase[CC1101_REGISTERS_COUNT], const u8 aTarget[CC1101_REGISTERS_COUNT]);
+ret_code_t 		iohub_cc1101_apply_profile(cc1101_ctx *aCtx, const cc1101_profile *aProfile);
+const cc1101_profile *iohub_cc1101_find_profile(const cc1101_profile *aProfiles, u8 aCount, const char *aName);
+
+	//Asynchronous serial receive: aProfile must select PKT_FORMAT = 3 with IOCFG2 = serial data (see
+	//iohub_cc1101_default_value.ook.h), aReceiver is initialized on the GDO2 pin with its decoders registered
+ret_code_t 		iohub_cc1101_async_receive_begin(cc1101_ctx *aCtx, const cc1101_profile *aProfile, digital_async_receiver *aReceiver);
+ret_code_t 		iohub_cc1101_async_receive_end(cc1101_ctx *aCtx);
+
+ret_code_t 		iohub_cc1101_set_channel(cc1101_ctx *aCtx, u8 aChannel);
+ret_code_t 		iohub_cc1101_set_pa_power(cc1101_ctx *aCtx, u8 aPaTable);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "iohub_cc1101.h"
+
+//https://www.ti.com/lit/ds/symlink/cc1101.pdf
+//https://www.ti.com/lit/an/swra215e/swra215e.pdf (DN022, OOK/ASK with CC1101)
+
+/*
+	433.92 MHz OOK receiver, asynchronous serial mode: no sync word, no FIFO, the demodulated
+	signal is output on GDO2 and sampled by a digital_async_receiver (Chacon DIO, Digoo R8H,
+	RS8706W...) instead of a superheterodyne module. See iohub_cc1101_async_receive_begin().
+*/
+
+#define CC1101_OOK_DEFVAL_IOCFG2		0x0D //Serial data output (asynchronous)
+#define CC1101_OOK_DEFVAL_IOCFG1		0x2E
+#define CC1101_OOK_DEFVAL_IOCFG0		0x2E //High impedance, no end of packet in this mode
+#define CC1101_OOK_DEFVAL_FIFOTHR		0x47
+#define CC1101_OOK_DEFVAL_SYNC1			0xD3
+#define CC1101_OOK_DEFVAL_SYNC0			0x91
+#define CC1101_OOK_DEFVAL_PKTLEN		0xFF
+#define CC1101_OOK_DEFVAL_PKTCTRL1		0x04
+#define CC1101_OOK_DEFVAL_PKTCTRL0		0x32 //PKT_FORMAT = 3 (asynchronous serial), infinite length, no CRC
+#define CC1101_OOK_DEFVAL_ADDR			0x00
+#define CC1101_OOK_DEFVAL_CHANNR		0x00
+#define CC1101_OOK_DEFVAL_FSCTRL1		0x06
+#define CC1101_OOK_DEFVAL_FSCTRL0		0x00
+#define CC1101_OOK_DEFVAL_FREQ2			0x10 //433.92 MHz
+#define CC1101_OOK_DEFVAL_FREQ1			0xB0
+#define CC1101_OOK_DEFVAL_FREQ0			0x71
+#define CC1101_OOK_DEFVAL_MDMCFG4		0x87 //203 kHz RX filter, cheap remotes drift a lot
+#define CC1101_OOK_DEFVAL_MDMCFG3		0x32
+#define CC1101_OOK_DEFVAL_MDMCFG2		0x30 //ASK/OOK, no preamble / sync
+#define CC1101_OOK_DEFVAL_MDMCFG1		0x22
+#define CC1101_OOK_DEFVAL_MDMCFG0		0xF8
+#define CC1101_OOK_DEFVAL_DEVIATN		0x15
+#define CC1101_OOK_DEFVAL_MCSM2			0x07
+#define CC1101_OOK_DEFVAL_MCSM1			0x00
+#define CC1101_OOK_DEFVAL_MCSM0			0x18
+#define CC1101_OOK_DEFVAL_FOCCFG		0x16
+#define CC1101_OOK_DEFVAL_BSCFG			0x6C
+#define CC1101_OOK_DEFVAL_AGCCTRL2		0x03 //DN022 recommended OOK AGC settings
+#define CC1101_OOK_DEFVAL_AGCCTRL1		0x00
+#define CC1101_OOK_DEFVAL_AGCCTRL0		0x91
+#define CC1101_OOK_DEFVAL_WOREVT1		0x87
+#define CC1101_OOK_DEFVAL_WOREVT0		0x6B
+#define CC1101_OOK_DEFVAL_WORCTRL		0xF8
+#define CC1101_OOK_DEFVAL_FREND1		0xB6 //DN022, better OOK sensitivity
+#define CC1101_OOK_DEFVAL_FREND0		0x11 //PATABLE[0] = off, PATABLE[1] = on
+#define CC1101_OOK_DEFVAL_FSCAL3		0xE9
+#define CC1101_OOK_DEFVAL_FSCAL2		0x2A
+#define CC1101_OOK_DEFVAL_FSCAL1		0x00
+#define CC1101_OOK_DEFVAL_FSCAL0		0x1F
+#define CC1101_OOK_DEFVAL_RCCTRL1		0x41
+#define CC1101_OOK_DEFVAL_RCCTRL0		0x00
+
+static u8 sC1101OokConfig[CC1101_REGISTERS_COUNT] = 
+{
+	CC1101_OOK_DEFVAL_IOCFG2,
+	CC1101_OOK_DEFVAL_IOCFG1,
+	CC1101_OOK_DEFVAL_IOCFG0,
+	CC1101_OOK_DEFVAL_FIFOTHR,
+	CC1101_OOK_DEFVAL_SYNC1,
+	CC1101_OOK_DEFVAL_SYNC0,
+	CC1101_OOK_DEFVAL_PKTLEN,
+	CC1101_OOK_DEFVAL_PKTCTRL1,
+	CC1101_OOK_DEFVAL_PKTCTRL0,
+	CC1101_OOK_DEFVAL_ADDR,
+	CC1101_OOK_DEFVAL_CHANNR,
+	CC1101_OOK_DEFVAL_FSCTRL1,
+	CC1101_OOK_DEFVAL_FSCTRL0,
+	CC1101_OOK_DEFVAL_FREQ2,
+	CC1101_OOK_DEFVAL_FREQ1,
+	CC1101_OOK_DEFVAL_FREQ0,
+	CC1101_OOK_DEFVAL_MDMCFG4,
+	CC1101_OOK_DEFVAL_MDMCFG3,
+	CC1101_OOK_DEFVAL_MDMCFG2,
+	CC1101_OOK_DEFVAL_MDMCFG1,
+	CC1101_OOK_DEFVAL_MDMCFG0,
+	CC1101_OOK_DEFVAL_DEVIATN,
+	CC1101_OOK_DEFVAL_MCSM2,
+	CC1101_OOK_DEFVAL_MCSM1,
+	CC1101_OOK_DEFVAL_MCSM0,
+	CC1101_OOK_DEFVAL_FOCCFG,
+	CC1101_OOK_DEFVAL_BSCFG,
+	CC1101_OOK_DEFVAL_AGCCTRL2,
+	CC1101_OOK_DEFVAL_AGCCTRL1,
+	CC1101_OOK_DEFVAL_AGCCTRL0,
+	CC1101_OOK_DEFVAL_WOREVT1,
+	CC1101_OOK_DEFVAL_WOREVT0,
+	CC1101_OOK_DEFVAL_WORCTRL,
+	CC1101_OOK_DEFVAL_FREND1,
+	CC1101_OOK_DEFVAL_FREND0,
+	CC1101_OOK_DEFVAL_FSCAL3,
+	CC1101_OOK_DEFVAL_FSCAL2,
+	CC1101_OOK_DEFVAL_FSCAL1,
+	CC1101_OOK_DEFVAL_FSCAL0,
+	CC1101_OOK_DEFVAL_RCCTRL1,
+	CC1101_OOK_DEFVAL_RCCTRL0
+};
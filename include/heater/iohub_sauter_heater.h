@@ -7,23 +7,71 @@
 extern "C" {
 #endif
 
+/*
+	Sauter heater remote control (see iohub_cc1101_default_value.sauter.h)
+	======================
+	A command is a 24 bytes frame (STX ... XOR CRC, ETX) sent after a 0x00 address byte. The frame
+	is built once from a template, only the mode, temperature and CRC bytes change per command.
+	The heater answers with a frame of the same layout, which is used as acknowledgement.
+*/
+
+#define SAUTER_HEATER_FRAME_LEN				24
+#define SAUTER_HEATER_ID_LEN				3		//Remote identifier, the heater is paired with it
+
+#define SAUTER_HEATER_TEMP_MIN				12.0f
+#define SAUTER_HEATER_TEMP_MAX				28.0f
+#define SAUTER_HEATER_TEMP_STEP				0.5f
+
+#ifndef SAUTER_HEATER_ACK_TIMEOUT_MS
+#	define SAUTER_HEATER_ACK_TIMEOUT_MS		60
+#endif
+
+#ifndef SAUTER_HEATER_RETRY_COUNT
+#	define SAUTER_HEATER_RETRY_COUNT		3
+#endif
+
 /* -------------------------------------------------------------- */
 
 typedef struct sauter_heater_s
 {
 	cc1101_ctx			*mCC1101;
-	
+	u8					mFrame[SAUTER_HEATER_FRAME_LEN];	//Template with this heater identifier
+
+		//Last command acknowledged by the heater
+	BOOL				mfStateValid;
+	BOOL				mfOn;
+	float				mTemperature;
+	float				mBoostTimeMinute;
 }sauter_heater;
 
+	//One entry per heater for iohub_sauter_heater_send_batch()
+typedef struct sauter_heater_command_s
+{
+	sauter_heater		*mHeater;
+	BOOL				mfOn;
+	float				mTemperature;
+	float				mBoostTimeMinute;		//> 0 selects the boost mode
+	ret_code_t			mResult;
+}sauter_heater_command;
+
 /* -------------------------------------------------------------- */
 
 ret_code_t								iohub_sauter_heater_init(sauter_heater *aCtx, cc1101_ctx *aCC1101);
 void    								iohub_sauter_heater_uninit(sauter_heater *aCtx);
 
+	//Heaters paired with another remote, the default identifier is the one of the captured remote
+void 									iohub_sauter_heater_set_id(sauter_heater *aCtx, const u8 anId[SAUTER_HEATER_ID_LEN]);
+
+	//Sends and waits for the acknowledgement, with retries
 ret_code_t			 					iohub_sauter_heater_send(sauter_heater *aCtx, BOOL afOn, float aTemperature, float aBoostTimeMinute);
+
+	//All commands in one radio wake-up / calibration, mResult is set for each entry. Heaters must share the same CC1101
+ret_code_t			 					iohub_sauter_heater_send_batch(sauter_heater_command *aCommands, u8 aCount);
+
+	//Last acknowledged state, E_INVALID_STATE before the first acknowledgement
 ret_code_t 								iohub_sauter_heater_read(sauter_heater *aCtx, BOOL *afOn, float *aTemperature, float *aBoostTimeMinute);
 u8 										iohub_sauter_heater_crc(u8 *aBuffer, u16 aBufferSize);
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
@@ -15,6 +15,8 @@ extern "C" {
 typedef struct heatpump_midea_s
 {
     u32					mDigitalPinTx;
+	iohub_fast_gpio		mTxGPIO;
+	digital_async_receiver	*mReceiver;
 	
 	u16					mTimings[2 + 6*8*2 + 2];
 	u16					mTimingCount;
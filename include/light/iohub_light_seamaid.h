@@ -33,6 +33,8 @@ typedef enum
 typedef struct light_seamaid_s
 {	
     u8					mDigitalPinTx;
+	iohub_fast_gpio		mTxGPIO;
+	digital_async_receiver	*mReceiver;		//Optional, co-located receiver to notify while sending
 	u16					mTimings[(24+1) * 2];
 	u16					mTimingCount;
 	u16					mTimingReadIdx;
@@ -45,6 +47,8 @@ typedef struct light_seamaid_s
 int     								iohub_light_seamaid_init(light_seamaid *aCtx, u8 aGPIOTx);
 void    								iohub_light_seamaid_uninit(light_seamaid *aCtx);
 
+void									iohub_light_seamaid_attach_receiver(light_seamaid *aCtx, digital_async_receiver *aReceiver);
+
 void 									iohub_light_seamaid_send(light_seamaid *aCtx, u16 anAddr, u8 aCmd);
 
 BOOL    								iohub_light_seamaid_read(light_seamaid *aCtx, u16 *anAddr, u8 *aCmd);
@@ -54,11 +54,25 @@ static inline ret_code_t iohub_detach_interrupt(u8 pin)
     return SUCCESS;
 }
 
+	//attachInterrupt() has no argument: one trampoline per interrupt pin (2 and 3) forwards its own one,
+	//so that several drivers (e.g. two CC1101 on the same SPI bus) each get their context back
+static gpio_isr_t	sISRHandlers[2];
+static void			*sISRArgs[2];
+
+static void iohub_isr_trampoline_2(void) { sISRHandlers[0](sISRArgs[0]); }
+static void iohub_isr_trampoline_3(void) { sISRHandlers[1](sISRArgs[1]); }
+
 ret_code_t iohub_attach_interrupt(u8 pin, gpio_isr_t isr_handler, gpio_int_type_t intr_type, void* arg)
 {
 	if (pin != 2 && pin != 3)
+	{
 		IOHUB_LOG_ERROR("PIN: %d, not valid for interrupt !", pin);
+		return E_INVALID_PARAMETERS;
+	}
+
+	sISRHandlers[pin - 2] = isr_handler;
+	sISRArgs[pin - 2] = arg;
 
-	attachInterrupt(digitalPinToInterrupt(pin), isr_handler, intr_type);
+	attachInterrupt(digitalPinToInterrupt(pin), (pin == 2) ? iohub_isr_trampoline_2 : iohub_isr_trampoline_3, intr_type);
 	return SUCCESS;
 }
\ No newline at end of file
@@ -7,7 +7,10 @@
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "freertos/portmacro.h"
+#include "soc/soc_caps.h"
+#include "soc/gpio_reg.h"
 
 #define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
 #include "esp_log.h"
@@ -33,15 +36,81 @@ static inline void iohub_platform_init()
 #define iohub_digital_read(aPin) \
     (gpio_get_level((gpio_num_t)(aPin)) ? PinLevel_High : PinLevel_Low)
 
+/* Fast GPIO: gpio_set_level() checks its arguments on every call (hundreds of ns, variable),
+   the handle holds the W1TS/W1TC register addresses so a toggle is a single store.
+   The pin must already be configured as output. */
+#define IOHUB_FAST_GPIO
+
+typedef struct iohub_fast_gpio_s
+{
+    volatile uint32_t   *mSetReg;
+    volatile uint32_t   *mClearReg;
+    uint32_t            mMask;
+}iohub_fast_gpio;
+
+static inline void iohub_fast_gpio_init(iohub_fast_gpio *aGPIO, u32 aPin)
+{
+#if SOC_GPIO_PIN_COUNT > 32
+    if (aPin >= 32) {
+        aGPIO->mSetReg = (volatile uint32_t *)GPIO_OUT1_W1TS_REG;
+        aGPIO->mClearReg = (volatile uint32_t *)GPIO_OUT1_W1TC_REG;
+        aGPIO->mMask = 1UL << (aPin - 32);
+        return;
+    }
+#endif
+    aGPIO->mSetReg = (volatile uint32_t *)GPIO_OUT_W1TS_REG;
+    aGPIO->mClearReg = (volatile uint32_t *)GPIO_OUT_W1TC_REG;
+    aGPIO->mMask = 1UL << aPin;
+}
+
+#define iohub_fast_gpio_uninit(aGPIO)                       do{}while(0)
+#define iohub_fast_gpio_set(aGPIO)                          (*(aGPIO)->mSetReg = (aGPIO)->mMask)
+#define iohub_fast_gpio_clear(aGPIO)                        (*(aGPIO)->mClearReg = (aGPIO)->mMask)
+
+
+/* Events: binary semaphore, the waiting task is blocked until the ISR gives it */
+#define IOHUB_EVENT
+
+typedef struct iohub_event_s
+{
+    SemaphoreHandle_t   mSemaphore;
+}iohub_event;
+
+static inline void iohub_event_init(iohub_event *aEvent)
+{
+    aEvent->mSemaphore = xSemaphoreCreateBinary();
+}
+
+static inline void iohub_event_uninit(iohub_event *aEvent)
+{
+    if (aEvent->mSemaphore != NULL)
+        vSemaphoreDelete(aEvent->mSemaphore);
+    aEvent->mSemaphore = NULL;
+}
+
+static inline void IRAM_ATTR iohub_event_signal_from_isr(iohub_event *aEvent)
+{
+    BaseType_t theHigherPriorityTaskWoken = pdFALSE;
+
+    xSemaphoreGiveFromISR(aEvent->mSemaphore, &theHigherPriorityTaskWoken);
+    if (theHigherPriorityTaskWoken)
+        portYIELD_FROM_ISR();
+}
+
+#define iohub_event_clear(aEvent)                           ((void)xSemaphoreTake((aEvent)->mSemaphore, 0))
+#define iohub_event_wait(aEvent, aTimeoutMs)                (xSemaphoreTake((aEvent)->mSemaphore, pdMS_TO_TICKS(aTimeoutMs)) == pdTRUE)
 
 #define iohub_time_delay_ms(anMSDelay)							vTaskDelay(pdMS_TO_TICKS(anMSDelay))
 #define iohub_time_delay_us(anUSDelay)							esp_rom_delay_us(anUSDelay)
 #define iohub_time_now_us()										esp_timer_get_time()
 #define iohub_time_now_ms()										(esp_timer_get_time() / 1000)
 
-/* Interrupt control for ESP32 */
-#define iohub_interrupts_disable()                                 portENTER_CRITICAL(NULL)
-#define iohub_interrupts_enable()                                  portEXIT_CRITICAL(NULL)
+/* Interrupt control for ESP32: a critical section needs a spinlock, NULL asserts on SMP targets.
+   One lock shared by the whole library (src/platform/esp32/iohub_platform.c), task context only */
+extern portMUX_TYPE gIohubCriticalMux;
+
+#define iohub_interrupts_disable()                                 portENTER_CRITICAL(&gIohubCriticalMux)
+#define iohub_interrupts_enable()                                  portEXIT_CRITICAL(&gIohubCriticalMux)
 
 #define IOHUB_GPIO_INT_TYPE_CHANGE       GPIO_INTR_ANYEDGE
 #define IOHUB_GPIO_INT_TYPE_FALLING      GPIO_INTR_NEGEDGE
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "utils/iohub_types.h"
+
 typedef enum 
 {
     PinMode_Output,
@@ -26,4 +28,80 @@ typedef enum
 	#include "platform/mpsse/iohub_platform.h"
 #elif defined(IOHUB_PLATFORM_ESP32)
 	#include "platform/esp32/iohub_platform.h"
-#endif
\ No newline at end of file
+#elif defined(IOHUB_PLATFORM_LINUX)
+	#include "platform/linux/iohub_platform.h"
+#endif
+
+/*
+	Fast GPIO
+	======================
+	Bit-banged transmitters resolve their pin once into an iohub_fast_gpio handle and toggle it
+	in their timing critical loops. Platforms able to do better than iohub_digital_write() (direct
+	register store) define IOHUB_FAST_GPIO and provide the handle, iohub_fast_gpio_init(),
+	iohub_fast_gpio_uninit(), iohub_fast_gpio_set() and iohub_fast_gpio_clear().
+	Generic macros remain the way to go for non critical code.
+
+	Pulse durations go through iohub_fast_gpio_delay_us() and a whole transmission is bracketed by
+	iohub_fast_gpio_waveform_begin() / iohub_fast_gpio_waveform_end(). Platforms that cannot toggle
+	pins in real time (MPSSE over USB) define IOHUB_FAST_GPIO_WAVEFORM and compile the levels and
+	delays into a sample buffer that is played back at once by iohub_fast_gpio_waveform_end().
+	Everywhere else delays are plain busy waits and begin/end do nothing.
+*/
+#ifndef IOHUB_FAST_GPIO
+typedef struct iohub_fast_gpio_s
+{
+	u32		mPin;
+}iohub_fast_gpio;
+
+#	define iohub_fast_gpio_init(aGPIO, aPin)				do { (aGPIO)->mPin = (aPin); } while(0)
+#	define iohub_fast_gpio_uninit(aGPIO)					do{}while(0)
+#	define iohub_fast_gpio_set(aGPIO)						iohub_digital_write((aGPIO)->mPin, PinLevel_High)
+#	define iohub_fast_gpio_clear(aGPIO)						iohub_digital_write((aGPIO)->mPin, PinLevel_Low)
+#endif
+
+#define iohub_fast_gpio_write(aGPIO, aPinLevel)				do { if ((aPinLevel) == PinLevel_High) iohub_fast_gpio_set(aGPIO); else iohub_fast_gpio_clear(aGPIO); } while(0)
+
+#ifndef IOHUB_FAST_GPIO_WAVEFORM
+#	define iohub_fast_gpio_delay_us(aGPIO, aDelayUs)		iohub_time_delay_us(aDelayUs)
+#	define iohub_fast_gpio_waveform_begin(aGPIO)			do{}while(0)
+#	define iohub_fast_gpio_waveform_end(aGPIO)				do{}while(0)
+#endif
+
+/*
+	Events
+	======================
+	Lets an interrupt handler wake up a task waiting for it. Platforms with a scheduler define
+	IOHUB_EVENT and block the waiting task. The generic fallback is a flag polled every
+	IOHUB_EVENT_POLL_US, which still costs no bus access while waiting.
+*/
+#ifndef IOHUB_EVENT_POLL_US
+#	define IOHUB_EVENT_POLL_US						100
+#endif
+
+#ifndef IOHUB_EVENT
+typedef struct iohub_event_s
+{
+	volatile BOOL	mfSignaled;
+}iohub_event;
+
+#	define iohub_event_init(aEvent)						do { (aEvent)->mfSignaled = FALSE; } while(0)
+#	define iohub_event_uninit(aEvent)					do{}while(0)
+#	define iohub_event_signal_from_isr(aEvent)			do { (aEvent)->mfSignaled = TRUE; } while(0)
+#	define iohub_event_clear(aEvent)					do { (aEvent)->mfSignaled = FALSE; } while(0)
+
+static inline BOOL iohub_event_wait(iohub_event *aEvent, u32 aTimeoutMs)
+{
+	uint64_t theStartUs = iohub_time_now_us();
+
+	while (!aEvent->mfSignaled)
+	{
+		if ((uint64_t)(iohub_time_now_us() - theStartUs) >= (uint64_t)aTimeoutMs * 1000)
+			return FALSE;
+
+		iohub_time_delay_us(IOHUB_EVENT_POLL_US);
+	}
+
+	aEvent->mfSignaled = FALSE;
+	return TRUE;
+}
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "utils/iohub_types.h"
+#include "platform/iohub_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	CC1101 register level model
+	======================
+
+	Attached to a chip select pin of the Linux SPI backend, it answers the header / data bytes
+	sent by src/heater/iohub_cc1101.c like the chip would: config / status registers, PATABLE,
+	strobes, MARCSTATE and both 64 bytes FIFOs.
+
+	Radio timings are not modelled: a packet is on air as soon as its last byte has been written
+	in TX state, and it is handed to the peer radio (or to itself when no peer is connected, if
+	TXOFF_MODE brings it back to RX). GDO0 follows IOCFG0 = 0x06 (sync / end of packet) on the
+	virtual GPIO bank, which raises the driver interrupt. GDO2, when wired, follows IOCFG2 = 0x00
+	(RX threshold or end of packet), 0x02 (TX threshold) or 0x06 with the FIFOTHR thresholds.
+
+	SPI transactions, bytes and CS edges are counted by the Linux SPI backend
+	(iohub_linux_spi_get_stats), the model counts strobes, calibrations and packets.
+*/
+
+#define CC1101_SIM_REGISTERS_COUNT			0x2F
+#define CC1101_SIM_FIFO_SIZE				64
+
+#ifndef CC1101_SIM_AIR_MAX
+#	define CC1101_SIM_AIR_MAX				4096	//Longest packet carried, bigger ones are dropped
+#endif
+
+/* -------------------------------------------------------------- */
+
+typedef struct cc1101_sim_stats_s
+{
+	u32		mStrobeCount;				//SNOP excluded
+	u32		mCalibrationCount;			//SCAL and automatic calibrations
+	u32		mPacketSentCount;
+	u32		mPacketReceivedCount;
+	u32		mPacketDroppedCount;		//Receiver not in RX, busy, or packet too long
+	u32		mCCARefusedCount;			//STX ignored, channel busy
+	u32		mPacketFilteredCount;		//Address, length or CRC (CRC_AUTOFLUSH) check failed
+}cc1101_sim_stats;
+
+typedef struct cc1101_sim_s
+{
+	u32					mCSnPin;
+	u32					mGDO0Pin;
+	u32					mGDO2Pin;				//IOHUB_GPIO_PIN_INVALID when not wired
+	struct cc1101_sim_s	*mPeer;
+
+	u8					mRegs[CC1101_SIM_REGISTERS_COUNT];
+	u8					mPaTable[8];
+	u8					mPaIndex;
+	u8					mState;					//MARCSTATE
+	BOOL				mfWor;
+	BOOL				mfPowerDownPending;		//SPWD, effective when CSn goes high
+	u8					mAutoCalCount;
+	BOOL				mfSyncEnd;				//Sync word seen, end of packet not reached yet
+	BOOL				mfRxThreshold;			//IOCFG 0x00 signal, released when the RX FIFO is empty
+
+		//SPI decoding
+	BOOL				mfExpectHeader;
+	u8					mAddr;
+	BOOL				mfBurst;
+	BOOL				mfRead;
+
+	u8					mRxFifo[CC1101_SIM_FIFO_SIZE];
+	u8					mRxHead;
+	u8					mRxCount;
+	u8					mTxFifo[CC1101_SIM_FIFO_SIZE];
+	u8					mTxHead;
+	u8					mTxCount;
+
+		//Packet being transmitted
+	u8					mTxAir[CC1101_SIM_AIR_MAX];
+	u32					mTxAirLen;
+
+		//Packet being received, moved to the RX FIFO as room is made
+	u8					mRxAir[CC1101_SIM_AIR_MAX + 2];
+	u32					mRxAirLen;
+	u32					mRxAirPos;
+	BOOL				mfRxInPacket;
+
+	u8					mRSSI;					//Reported for every received packet
+	u8					mLQI;
+	u8					mCCABusyCount;			//Next STX in RX refused by the clear channel assessment
+	u8					mCorruptCount;			//Next packets received with a bad CRC
+
+	cc1101_sim_stats	mStats;
+}cc1101_sim;
+
+/* -------------------------------------------------------------- */
+
+ret_code_t 		iohub_cc1101_sim_init(cc1101_sim *aSim, u32 aCSnPin, u32 aGDO0Pin);
+void 			iohub_cc1101_sim_uninit(cc1101_sim *aSim);
+
+void 			iohub_cc1101_sim_set_gdo2_pin(cc1101_sim *aSim, u32 aGDO2Pin);
+
+	//Symmetric, NULL disconnects
+void 			iohub_cc1101_sim_connect(cc1101_sim *aSim, cc1101_sim *aPeer);
+
+	//Receive aData as if it came over the air (length byte included in variable length mode)
+ret_code_t 		iohub_cc1101_sim_inject(cc1101_sim *aSim, const u8 *aData, u32 aLength);
+
+void 			iohub_cc1101_sim_set_link(cc1101_sim *aSim, u8 aRSSI, u8 aLQI);
+
+	//The next aRefusals STX strobes in RX fail the clear channel assessment (when MCSM1.CCA_MODE is set)
+void 			iohub_cc1101_sim_set_channel_busy(cc1101_sim *aSim, u8 aRefusals);
+
+	//The next aCount received packets have a bad CRC (dropped with PKTCTRL1.CRC_AUTOFLUSH and PKTCTRL0.CRC_EN)
+void 			iohub_cc1101_sim_corrupt(cc1101_sim *aSim, u8 aCount);
+
+#ifdef __cplusplus
+}
+#endif
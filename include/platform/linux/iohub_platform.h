@@ -0,0 +1,162 @@
+#pragma once
+
+#include "utils/iohub_errors.h"
+#include "utils/iohub_types.h"
+
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+#include <sched.h>
+
+/*
+	Linux host platform
+	======================
+
+	No hardware is accessed: GPIOs are virtual and only live in memory.
+	An edge written on a pin is forwarded to the interrupt handler attached to that same pin,
+	so a transmitter and a digital_async_receiver sharing a pin form a loopback.
+	SPI transfers go to software models attached to the chip select pin (see iohub_linux_spi_attach).
+	Time can be switched to a virtual clock that only iohub_time_delay_us() advances, which makes
+	bit-banged pulse widths deterministic (see iohub_linux_time_set_virtual).
+
+	This platform is meant to run drivers and timing harnesses on a PC / in CI.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IRAM_ATTR
+
+#define IOHUB_LOG_PRINTF
+
+#ifndef IOHUB_LINUX_GPIO_COUNT
+#	define IOHUB_LINUX_GPIO_COUNT								64
+#endif
+
+	//Below this remaining time, iohub_time_delay_us() busy waits instead of sleeping (nanosleep overshoot is ~50-100us)
+#define IOHUB_LINUX_DELAY_SPIN_US								200
+
+typedef u32 gpio_num_t;
+typedef void (*gpio_isr_t)(void *arg);
+
+typedef enum
+{
+	GPIOIntType_Change = 0,
+	GPIOIntType_Falling,
+	GPIOIntType_Rising
+}gpio_int_type_t;
+
+#define IOHUB_GPIO_INT_TYPE_CHANGE								GPIOIntType_Change
+#define IOHUB_GPIO_INT_TYPE_FALLING								GPIOIntType_Falling
+#define IOHUB_GPIO_INT_TYPE_RISING								GPIOIntType_Rising
+
+/* -------------------------------------------------------------- */
+
+void 			iohub_linux_gpio_set_pin_mode(u32 aPin, IOHubPinMode aPinMode);
+void 			iohub_linux_gpio_write(u32 aPin, IOHubPinLevel aPinLevel);
+IOHubPinLevel 	iohub_linux_gpio_read(u32 aPin);
+
+ret_code_t 		iohub_attach_interrupt(gpio_num_t pin, gpio_isr_t isr_handler, gpio_int_type_t intr_type, void* arg);
+ret_code_t 		iohub_detach_interrupt(u8 pin);
+
+/*
+	Virtual SPI devices: a model registered on a chip select pin receives the transfers made
+	through any spi_ctx using that pin. Every device gets transaction / byte / CS edge counters.
+*/
+#ifndef IOHUB_LINUX_SPI_DEVICE_COUNT
+#	define IOHUB_LINUX_SPI_DEVICE_COUNT							4
+#endif
+
+typedef struct iohub_linux_spi_device_s
+{
+	void 		(*mSelect)(void *aDeviceCtx);
+	void 		(*mDeselect)(void *aDeviceCtx);
+	void 		(*mTransfer)(void *aDeviceCtx, u8 *aBuffer, u16 aBufferLen);	//Full duplex, in place
+}iohub_linux_spi_device;
+
+typedef struct iohub_linux_spi_stats_s
+{
+	u32			mTransactionCount;		//CSn asserted
+	u32			mCSToggleCount;			//Every CSn edge
+	u32			mTransferCount;
+	u32			mByteCount;
+}iohub_linux_spi_stats;
+
+ret_code_t 		iohub_linux_spi_attach(u32 aCSnPin, const iohub_linux_spi_device *aDevice, void *aDeviceCtx);
+void 			iohub_linux_spi_detach(u32 aCSnPin);
+ret_code_t 		iohub_linux_spi_get_stats(u32 aCSnPin, iohub_linux_spi_stats *aStats);
+void 			iohub_linux_spi_reset_stats(u32 aCSnPin);
+
+/*
+	Virtual clock: while enabled, iohub_time_now_us() returns gIohubLinuxVirtualTimeUs and
+	iohub_time_delay_us() adds to it without sleeping. Code polling the time without delaying
+	never sees it move, only enable it around bit-banged transmissions.
+*/
+extern BOOL			gIohubLinuxVirtualClock;
+extern uint64_t		gIohubLinuxVirtualTimeUs;
+
+void 			iohub_linux_time_set_virtual(BOOL afEnable);
+
+/* -------------------------------------------------------------- */
+
+static inline void iohub_platform_init()
+{
+	//Nothing to do
+}
+
+#define iohub_digital_set_pin_mode(aPin, aPinMode)				iohub_linux_gpio_set_pin_mode(aPin, aPinMode)
+#define iohub_digital_write(aPin, aPinLevel)					iohub_linux_gpio_write(aPin, aPinLevel)
+#define iohub_digital_read(aPin)								iohub_linux_gpio_read(aPin)
+
+	//Virtual interrupts are raised synchronously from iohub_digital_write(), nothing to mask
+#define iohub_interrupts_disable()								do{}while(0)
+#define iohub_interrupts_enable()								do{}while(0)
+
+static inline uint64_t iohub_time_now_us(void)
+{
+	if (gIohubLinuxVirtualClock)
+		return gIohubLinuxVirtualTimeUs;
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ULL + (ts.tv_nsec / 1000ULL);
+}
+
+#define iohub_time_now_ms()										(iohub_time_now_us() / 1000)
+
+static inline void iohub_time_delay_us(unsigned long us)
+{
+	if (gIohubLinuxVirtualClock)
+	{
+		gIohubLinuxVirtualTimeUs += us;
+		return;
+	}
+
+	uint64_t theEndUs = iohub_time_now_us() + us;
+
+	if (us > IOHUB_LINUX_DELAY_SPIN_US)
+	{
+		struct timespec ts;
+		unsigned long theSleepUs = us - IOHUB_LINUX_DELAY_SPIN_US;
+
+		ts.tv_sec = theSleepUs / 1000000UL;
+		ts.tv_nsec = (theSleepUs % 1000000UL) * 1000UL;
+		nanosleep(&ts, NULL);
+	}
+
+	while (iohub_time_now_us() < theEndUs);
+}
+
+#define iohub_time_delay_ms(anMSDelay)							iohub_time_delay_us((anMSDelay) * 1000UL)
+
+static inline void iohub_set_real_time(int enable)
+{
+	struct sched_param param;
+	param.sched_priority = enable ? 20 : 0;
+	sched_setscheduler(0, enable ? SCHED_RR : SCHED_OTHER, &param);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,11 +1,72 @@
 #pragma once
 
 #include "mpsse.h"
+#include "utils/iohub_errors.h"
+#include "utils/iohub_types.h"
 
 extern struct mpsse_context *gMPSSECtx;
 
 #define IRAM_ATTR
 
+/*
+	Waveform transmit
+	======================
+	Every PinHigh() / PinLow() is a USB round trip, OOK pulses of a few hundred us cannot be
+	produced that way. Between iohub_fast_gpio_waveform_begin() and iohub_fast_gpio_waveform_end()
+	the fast GPIO calls do not touch the pin: levels and delays are compiled into one sample per
+	bitbang clock tick, then the whole buffer is streamed in a single bulk write with the FTDI
+	in bitbang mode. The MPSSE mode is restored afterwards.
+	Pins are numbered as for iohub_digital_write() (libmpsse): GPIOL0-3 (0 to 3) are ADBUS4-7 and
+	can be streamed. waveform_begin() samples the other ADBUS pins and every sample keeps driving
+	them at the level and direction they had, so a chip select on ADBUS3 does not float during the
+	playback. GPIOH0-7 (4 to 11) are on ACBUS, out of reach of the A interface bitbang:
+	waveform_begin() refuses them and the calls fall back to PinHigh() / PinLow() with real delays.
+	The bitbang clock divider is not documented the same way for every FTDI chip, so the first
+	waveform_begin() measures the sample rate actually produced, corrects the baudrate once and
+	compiles delays with the measured rate (iohub_fast_gpio_waveform_rate_hz()).
+*/
+#define IOHUB_FAST_GPIO
+#define IOHUB_FAST_GPIO_WAVEFORM
+
+	//Bitbang sample clock, 1 sample per us
+#ifndef IOHUB_MPSSE_WAVEFORM_SAMPLE_RATE_HZ
+#	define IOHUB_MPSSE_WAVEFORM_SAMPLE_RATE_HZ					1000000
+#endif
+
+	//First guess for the bitbang baudrate, the sample rate it gives is measured and corrected at runtime
+#ifndef IOHUB_MPSSE_WAVEFORM_BAUDRATE
+#	define IOHUB_MPSSE_WAVEFORM_BAUDRATE						(IOHUB_MPSSE_WAVEFORM_SAMPLE_RATE_HZ / 16)
+#endif
+
+	//A waveform longer than this is rejected (1 byte per sample)
+#ifndef IOHUB_MPSSE_WAVEFORM_MAX_SAMPLES
+#	define IOHUB_MPSSE_WAVEFORM_MAX_SAMPLES						(2 * 1024 * 1024)
+#endif
+
+typedef struct iohub_fast_gpio_s
+{
+	u32			mPin;
+	u8			mMask;			//ADBUS bit of the pin in bitbang samples, 0 when it cannot be streamed
+	u8			mLevel;			//Current level while compiling a waveform
+	u8			mIdleSample;	//Levels of the other ADBUS output pins, sampled by waveform_begin()
+	u8			mDirection;		//ADBUS outputs during the playback
+	BOOL		mfWaveform;		//TRUE between waveform_begin() and waveform_end()
+	BOOL		mfOverflow;
+	u8			*mSamples;
+	u32			mSampleCount;
+	u32			mSampleMax;
+}iohub_fast_gpio;
+
+void 		iohub_fast_gpio_init(iohub_fast_gpio *aGPIO, u32 aPin);
+void 		iohub_fast_gpio_uninit(iohub_fast_gpio *aGPIO);
+void 		iohub_fast_gpio_set(iohub_fast_gpio *aGPIO);
+void 		iohub_fast_gpio_clear(iohub_fast_gpio *aGPIO);
+void 		iohub_fast_gpio_delay_us(iohub_fast_gpio *aGPIO, u32 aDelayUs);
+
+ret_code_t 	iohub_fast_gpio_waveform_begin(iohub_fast_gpio *aGPIO);
+ret_code_t 	iohub_fast_gpio_waveform_end(iohub_fast_gpio *aGPIO);
+u32 		iohub_fast_gpio_waveform_rate_hz(void);	//Measured sample rate, 0 before the first waveform_begin()
+
 static inline void	iohub_platform_init()
 {
 	//Nothing to do
@@ -20,9 +81,13 @@ static inline void	iohub_platform_init()
 				IOHUB_LOG_ERROR("Device FTDI not found"); \
 		}while(0)
 
-#	define iohub_digital_write(aPin, aPinLevel)							do { (aPinLevel == PinLevel_High) ? PinHigh(gMPSSECtx, aPin); PinLow(gMPSSECtx, aPin); } while(0)
+#	define iohub_digital_write(aPin, aPinLevel)							do { if ((aPinLevel) == PinLevel_High) PinHigh(gMPSSECtx, aPin); else PinLow(gMPSSECtx, aPin); } while(0)
 #	define iohub_digital_read(aPin)										(PinState(gMPSSECtx, aPin, -1) ? PinLevel_High : PinLevel_Low)
 
+	//Host side has nothing to mask, timing critical output goes through the waveform player
+#	define iohub_interrupts_disable()									do{}while(0)
+#	define iohub_interrupts_enable()									do{}while(0)
+
 #	define iohub_time_delay_ms(anMSDelay)								iohub_time_delay_us((anMSDelay) * 1000)
 
 #ifdef _WIN32
@@ -20,6 +20,34 @@ static inline void iohub_platform_init()
 #define iohub_digital_write(aPin, aPinLevel)					digitalWrite (aPin, (aPinLevel == PinLevel_High) ? HIGH : LOW)
 #define iohub_digital_read(aPin)								(digitalRead(aPin) == HIGH ? PinLevel_High : PinLevel_Low)
 
+/* Fast GPIO: digitalWrite() translates the pin and goes through a function call on every edge.
+   Handles map /dev/gpiomem (BCM283x/BCM2711 register block) so set/clear is a single store.
+   The mapping is only used when /proc/device-tree/compatible names a BCM2835/6/7 or BCM2711, on
+   anything else (i.e. Pi 5, RP1 GPIO) or when /dev/gpiomem is not available the line is requested
+   through the GPIO chardev v2 API, and as a last resort handles fall back to digitalWrite().
+   aPin is a wiringPi pin number. */
+#define IOHUB_FAST_GPIO
+
+#ifndef IOHUB_RPI_GPIOCHIP_DEV
+#	define IOHUB_RPI_GPIOCHIP_DEV								"/dev/gpiochip0"
+#endif
+
+typedef struct iohub_fast_gpio_s
+{
+	volatile uint32_t	*mSetReg;		//NULL when memory mapping is not available
+	volatile uint32_t	*mClearReg;
+	uint32_t			mMask;
+	int					mLineFd;		//Chardev line request, -1 if not used
+	int					mPin;			//wiringPi pin
+}iohub_fast_gpio;
+
+void 	iohub_fast_gpio_init(iohub_fast_gpio *aGPIO, uint32_t aPin);
+void 	iohub_fast_gpio_uninit(iohub_fast_gpio *aGPIO);
+void 	iohub_rpi_fast_gpio_write_slow(iohub_fast_gpio *aGPIO, int aLevel);
+
+#define iohub_fast_gpio_set(aGPIO)								do { if ((aGPIO)->mSetReg) *(aGPIO)->mSetReg = (aGPIO)->mMask; else iohub_rpi_fast_gpio_write_slow(aGPIO, 1); } while(0)
+#define iohub_fast_gpio_clear(aGPIO)							do { if ((aGPIO)->mClearReg) *(aGPIO)->mClearReg = (aGPIO)->mMask; else iohub_rpi_fast_gpio_write_slow(aGPIO, 0); } while(0)
+
 static inline void iohub_time_delay_us(unsigned long us)
 {
 #ifdef HAVE_USLEEP
@@ -13,6 +13,8 @@ extern "C" {
 typedef struct chacon_dio_s
 {
     u8					mDigitalPinTx;
+	iohub_fast_gpio		mTxGPIO;
+	digital_async_receiver	*mReceiver;		//Optional, co-located receiver to notify while sending
 	
 	u16					mTimings[132 + 1];
 	u16					mTimingCount;
@@ -24,6 +26,8 @@ typedef struct chacon_dio_s
 int     								iohub_chacon_dio_init(chacon_dio *aCtx, u8 aGPIOTx);
 void    								iohub_chacon_dio_uninit(chacon_dio *aCtx);
 
+void									iohub_chacon_dio_attach_receiver(chacon_dio *aCtx, digital_async_receiver *aReceiver);
+
 void   				 					iohub_chacon_dio_send(chacon_dio *aCtx, BOOL afON, u32 aSenderID, u8 aReceiverID);
 BOOL    								iohub_chacon_dio_read(chacon_dio *aCtx, u32 *aSenderID, u8 *aReceiverID, BOOL *afON);
 
@@ -9,10 +9,28 @@ extern "C" {
 
 #ifndef DIGITAL_ASYNC_RECEIVER_INTERFACE_MAX
 #	define DIGITAL_ASYNC_RECEIVER_INTERFACE_MAX			2
+#endif
+
+	//Time the receiver keeps ignoring (or tagging) frames after a local transmission, the RF module AGC needs to recover
+#ifndef DIGITAL_ASYNC_RECEIVER_TX_GUARD_US
+#	define DIGITAL_ASYNC_RECEIVER_TX_GUARD_US			10000
+#endif
+
+	//Largest payload a transmitter can register with tx_begin for echo matching
+#ifndef DIGITAL_ASYNC_RECEIVER_ECHO_PAYLOAD_MAX
+#	define DIGITAL_ASYNC_RECEIVER_ECHO_PAYLOAD_MAX		8
 #endif
 
 /* -------------------------------------------------------------- */
 
+typedef enum
+{
+	DigitalAsyncReceiverEcho_Drop = 0,		//Edges are ignored during local transmission + guard time (no decoding CPU cost)
+	DigitalAsyncReceiverEcho_Tag			//The transmitting protocol keeps decoding, frames matching the sent payload are flagged as echo (loopback health check)
+}DigitalAsyncReceiverEchoMode;
+
+/* -------------------------------------------------------------- */
+
 typedef struct digital_async_receiver_s
 {	
 	u8											mPin;
@@ -22,6 +40,16 @@ typedef struct digital_async_receiver_s
 	digital_async_receiver_interface_ctx		*mInterfaceCtx[DIGITAL_ASYNC_RECEIVER_INTERFACE_MAX];
 	u8											mPluginCount;
 	volatile u16								mPacketReady; //Avoid compiler optimization because it's used from ISR and main
+
+	DigitalAsyncReceiverEchoMode				mEchoMode;
+	u32											mTxGuardUs;
+	u16											mTxReceiverId;	//Protocol currently transmitted locally
+	volatile BOOL								mfTxActive;
+	volatile BOOL								mfTxGuard;
+	volatile u32								mTxEndTimeUs;
+	volatile u16								mPacketInTxWindow;	//Same bit layout as mPacketReady, frames completed during the tx window
+	u8											mTxPayload[DIGITAL_ASYNC_RECEIVER_INTERFACE_MAX][DIGITAL_ASYNC_RECEIVER_ECHO_PAYLOAD_MAX];	//Last payload sent per interface
+	u8											mTxPayloadLen[DIGITAL_ASYNC_RECEIVER_INTERFACE_MAX];
 }digital_async_receiver;
 
 /* -------------------------------------------------------------- */
@@ -42,6 +70,14 @@ BOOL    	iohub_digital_async_receiver_register(digital_async_receiver *ctx, cons
 
 void    	iohub_digital_async_receiver_real_time_dump(digital_async_receiver *ctx);
 
+	///Local transmission coupling, called by transmitters sharing the air with this receiver
+void		iohub_digital_async_receiver_set_echo_mode(digital_async_receiver *ctx, DigitalAsyncReceiverEchoMode aMode, u32 aGuardUs);
+	///\note aPayload must be packed like the interface getPayload callback does, frames of this receiverId decoded in the tx window are echo only if they match it
+void		iohub_digital_async_receiver_tx_begin(digital_async_receiver *ctx, u16 receiverId, const u8 *aPayload, u8 aPayloadLen);
+void		iohub_digital_async_receiver_tx_end(digital_async_receiver *ctx);
+	///\note decodes the pending frame (main context only), always FALSE for interfaces without getPayload
+BOOL		iohub_digital_async_receiver_is_echo(digital_async_receiver *ctx, u16 receiverId);
+
 #ifdef __cplusplus
 }
 #endif
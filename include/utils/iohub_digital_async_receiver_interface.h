@@ -13,6 +13,7 @@ typedef struct digital_async_receiver_interface_s
 	u16		Id;
 	BOOL 	(*detectPacket)	(digital_async_receiver_interface_ctx *ctx, u16 durationUs);
 	void 	(*packetHandled)(digital_async_receiver_interface_ctx *ctx);
+	u8		(*getPayload)	(digital_async_receiver_interface_ctx *ctx, u8 *aBuffer, u8 aBufferLen); //Optional, packs the pending frame without consuming it, returns 0 if invalid
 }digital_async_receiver_interface;
 
 #ifdef __cplusplus
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "utils/iohub_types.h"
+#include "platform/iohub_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	Transmit timing instrumentation
+	======================
+
+	When IOHUB_TX_TIMING is defined, bit-banged transmitters record a timestamp at every
+	pin transition together with the duration they intended for that level.
+	Once the send is done, the recorded runs are compared to the intended ones and
+	errors are reported per symbol (a symbol is a pin level + an intended duration).
+
+	Usage:
+		iohub_tx_timing_start();
+		iohub_chacon_dio_send(...);
+		iohub_tx_timing_stop();
+		iohub_tx_timing_analyze(&report);
+*/
+
+#ifndef IOHUB_TX_TIMING_MAX_EDGES
+#	define IOHUB_TX_TIMING_MAX_EDGES			512
+#endif
+
+#ifndef IOHUB_TX_TIMING_MAX_SYMBOLS
+#	define IOHUB_TX_TIMING_MAX_SYMBOLS			12
+#endif
+
+#ifdef IOHUB_TX_TIMING
+#	define IOHUB_TX_TIMING_RECORD(aLevel, anExpectedUs)		iohub_tx_timing_record(aLevel, anExpectedUs)
+#else
+#	define IOHUB_TX_TIMING_RECORD(aLevel, anExpectedUs)		do{}while(0)
+#endif
+
+/* -------------------------------------------------------------- */
+
+typedef struct tx_timing_symbol_s
+{
+	IOHubPinLevel		mLevel;
+	u32					mExpectedUs;
+	u16					mCount;
+	s32					mMeanErrorUs; 	//Signed, > 0 means pulses are too long
+	u32					mP99ErrorUs;	//Absolute
+	u32					mMaxErrorUs;	//Absolute
+}tx_timing_symbol;
+
+typedef struct tx_timing_report_s
+{
+	tx_timing_symbol	mSymbols[IOHUB_TX_TIMING_MAX_SYMBOLS];
+	u8					mSymbolCount;
+	u16					mEdgeCount;
+	BOOL				mfOverflow;		//Some edges or symbols were not recorded
+}tx_timing_report;
+
+/* -------------------------------------------------------------- */
+
+void 			iohub_tx_timing_start(void);
+void 			iohub_tx_timing_stop(void);
+
+void 			iohub_tx_timing_record(IOHubPinLevel aLevel, u32 anExpectedUs);
+
+ret_code_t 		iohub_tx_timing_analyze(tx_timing_report *aReport);
+void 			iohub_tx_timing_dump(const tx_timing_report *aReport);
+
+#ifdef __cplusplus
+}
+#endif
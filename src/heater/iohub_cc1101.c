@@ -33,6 +33,142 @@
 #define CC1101_CONFIG_REGISTER   READ_SINGLE
 #define CC1101_STATUS_REGISTER   READ_BURST
 
+/**
+ * Configuration registers
+ */
+#define CC1101_IOCFG2            0x00        // GDO2 output pin configuration
+#define CC1101_IOCFG1            0x01        // GDO1 output pin configuration
+#define CC1101_IOCFG0            0x02        // GDO0 output pin configuration
+#define CC1101_FIFOTHR           0x03        // RX FIFO and TX FIFO thresholds
+#define CC1101_SYNC1             0x04        // Sync word, high byte
+#define CC1101_SYNC0             0x05        // Sync word, low byte
+#define CC1101_PKTLEN            0x06        // Packet length
+#define CC1101_PKTCTRL1          0x07        // Packet automation control
+#define CC1101_PKTCTRL0          0x08        // Packet automation control
+#define CC1101_ADDR              0x09        // Device address
+#define CC1101_CHANNR            0x0A        // Channel number
+#define CC1101_FSCTRL1           0x0B        // Frequency synthesizer control
+#define CC1101_FSCTRL0           0x0C        // Frequency synthesizer control
+#define CC1101_FREQ2             0x0D        // Frequency control word, high byte
+#define CC1101_FREQ1             0x0E        // Frequency control word, middle byte
+#define CC1101_FREQ0             0x0F        // Frequency control word, low byte
+#define CC1101_MDMCFG4           0x10        // Modem configuration
+#define CC1101_MDMCFG3           0x11        // Modem configuration
+#define CC1101_MDMCFG2           0x12        // Modem configuration
+#define CC1101_MDMCFG1           0x13        // Modem configuration
+#define CC1101_MDMCFG0           0x14        // Modem configuration
+#define CC1101_DEVIATN           0x15        // Modem deviation setting
+#define CC1101_MCSM2             0x16        // Main Radio Control State Machine configuration
+#define CC1101_MCSM1             0x17        // Main Radio Control State Machine configuration
+#define CC1101_MCSM0             0x18        // Main Radio Control State Machine configuration
+#define CC1101_FOCCFG            0x19        // Frequency Offset Compensation configuration
+#define CC1101_BSCFG             0x1A        // Bit Synchronization configuration
+#define CC1101_AGCCTRL2          0x1B        // AGC control
+#define CC1101_AGCCTRL1          0x1C        // AGC control
+#define CC1101_AGCCTRL0          0x1D        // AGC control
+#define CC1101_WOREVT1           0x1E        // High byte Event 0 timeout
+#define CC1101_WOREVT0           0x1F        // Low byte Event 0 timeout
+#define CC1101_WORCTRL           0x20        // Wake On Radio control
+#define CC1101_FREND1            0x21        // Front end RX configuration
+#define CC1101_FREND0            0x22        // Front end TX configuration
+#define CC1101_FSCAL3            0x23        // Frequency synthesizer calibration
+#define CC1101_FSCAL2            0x24        // Frequency synthesizer calibration
+#define CC1101_FSCAL1            0x25        // Frequency synthesizer calibration
+#define CC1101_FSCAL0            0x26        // Frequency synthesizer calibration
+#define CC1101_RCCTRL1           0x27        // RC oscillator configuration
+#define CC1101_RCCTRL0           0x28        // RC oscillator configuration
+
+	//Registers updated by the chip itself (calibration results), never served from the shadow
+#define CC1101_IS_VOLATILE_REG(aRegAddr)	((aRegAddr) >= CC1101_FSCAL3 && (aRegAddr) <= CC1101_FSCAL1)
+
+	//Chip status byte fields
+#define CC1101_STATUS_CHIP_RDYn				0x80
+#define CC1101_STATUS_STATE(aStatus)		(((aStatus) >> 4) & 0x07)
+#define CC1101_STATUS_FIFO_BYTES(aStatus)	((aStatus) & 0x0F)
+
+	//A status byte older than this is not trusted, the radio changes state by itself (end of RX / TX)
+#ifndef CC1101_STATUS_FRESH_US
+#	define CC1101_STATUS_FRESH_US			50
+#endif
+
+	//State waits: first poll after 3/4 of the mean duration of this transition, then a doubling backoff
+#ifndef CC1101_STATE_POLL_MIN_US
+#	define CC1101_STATE_POLL_MIN_US			10
+#endif
+#ifndef CC1101_STATE_POLL_MAX_US
+#	define CC1101_STATE_POLL_MAX_US			500
+#endif
+
+	//PKTCTRL0 / PKTCTRL1 / FIFOTHR fields
+#define CC1101_PKTCTRL0_LENGTH_MASK			0x03
+#define CC1101_PKTCTRL0_LENGTH_FIXED		0x00
+#define CC1101_PKTCTRL0_LENGTH_VARIABLE		0x01
+#define CC1101_PKTCTRL0_LENGTH_INFINITE		0x02
+#define CC1101_PKTCTRL0_FORMAT_MASK			0x30
+#define CC1101_PKTCTRL0_FORMAT_ASYNC		0x30 //Asynchronous serial, data in / out on the GDO pins
+#define CC1101_PKTCTRL1_APPEND_STATUS		0x04
+#define CC1101_PKTCTRL1_CRC_AUTOFLUSH		0x08
+#define CC1101_PKTCTRL1_ADR_CHK_MASK		0x03
+#define CC1101_PKTCTRL0_CRC_EN				0x04
+#define CC1101_FIFOTHR_MASK					0x0F
+#define CC1101_MCSM1_RXOFF_MASK				0x0C
+#define CC1101_MCSM1_RXOFF_RX				0x0C
+#define CC1101_MCSM1_TXOFF_MASK				0x03
+#define CC1101_MCSM1_TXOFF_FSTXON			0x01
+#define CC1101_MCSM1_TXOFF_TX				0x02
+#define CC1101_MCSM1_TXOFF_RX				0x03
+#define CC1101_MCSM1_CCA_MASK				0x30
+#define CC1101_MCSM1_CCA_SHIFT				4
+#define CC1101_AGCCTRL1_CS_REL_MASK			0x30
+#define CC1101_AGCCTRL1_CS_REL_SHIFT		4
+#define CC1101_AGCCTRL1_CS_ABS_MASK			0x0F
+
+	//STX in RX: time given to the chip to leave RX when the channel is clear
+#define CC1101_CCA_DECISION_US				100
+#define CC1101_MCSM0_FS_AUTOCAL_MASK		0x30
+#define CC1101_MCSM0_FS_AUTOCAL_NEVER		0x00
+#define CC1101_MCSM0_FS_AUTOCAL_4TH			0x30 //Every 4th return to IDLE, recommended with WOR
+#define CC1101_MCSM2_RX_TIME_QUAL			0x08 //Stay in RX when the preamble quality is reached
+#define CC1101_WORCTRL_EVENT1_RC_CAL		0x78 //RC_PD = 0, EVENT1 = 7, RC_CAL = 1
+
+#ifndef CC1101_XOSC_HZ
+#	define CC1101_XOSC_HZ					26000000ULL
+#endif
+
+	//Wake-on-Radio current estimate, typical datasheet figures
+#ifndef CC1101_WOR_RX_CURRENT_UA
+#	define CC1101_WOR_RX_CURRENT_UA			15700
+#endif
+#define CC1101_WOR_SLEEP_CURRENT_NA			900		//SLEEP with the RC oscillator running
+#define CC1101_WOR_STARTUP_US				240		//XOSC start and IDLE before RX
+#define CC1101_WOR_STARTUP_CURRENT_UA		1700
+#define CC1101_WOR_CAL_US					721
+#define CC1101_WOR_CAL_CURRENT_UA			8200
+#define CC1101_WOR_MIN_RX_BYTES				4		//Listen window must at least see this much preamble
+
+#ifndef CC1101_RSSI_OFFSET_DB
+#	define CC1101_RSSI_OFFSET_DB			74		//Typical at 433 / 868 MHz, see the datasheet table for the data rate in use
+#endif
+#define CC1101_RSSI_SETTLE_US				300		//RX entry (no calibration) until RSSI is valid
+#define CC1101_FIFOTHR_STREAM				0x07 //TX: 33 bytes, RX: 32 bytes
+
+	//GDOx configurations used while streaming
+#define CC1101_IOCFG_RX_THR_OR_END			0x00 //RX FIFO at or above threshold, or end of packet
+#define CC1101_IOCFG_TX_THR					0x02 //TX FIFO at or above threshold
+#define CC1101_IOCFG_SERIAL_DATA			0x0D //Demodulated data, asynchronous serial mode
+#define CC1101_IOCFG_SYNC_OR_END			0x06 //Sync word sent / received until the end of the packet
+#define CC1101_STREAM_TX_CHUNK				31   //Room guaranteed when the TX threshold (33) signal is low
+
+#define CC1101_INFINITE_HEADER_LEN			2
+#define CC1101_STREAM_POLL_US				100
+
+#ifndef CC1101_STREAM_TIMEOUT_MS
+#	define CC1101_STREAM_TIMEOUT_MS			1000
+#endif
+
+	//Clean registers between two dirty ranges are rewritten rather than paying one more header + CSn cycle
+#define CC1101_FLUSH_MERGE_GAP		2
+
 /**
  * PATABLE & FIFO's
  */
@@ -113,7 +249,7 @@ typedef enum
 /**
  * Macros
  */
-#define getState(aCtx)                  (iohub_cc1101_read_status_reg(aCtx, CC1101_MARCSTATE) & 0x1F)
+#define getState(aCtx)                  iohub_cc1101_get_state(aCtx)
 
 #define setRxState(aCtx)                iohub_cc1101_strobe(aCtx, CC1101_SRX)
 #define setTxState(aCtx)                iohub_cc1101_strobe(aCtx, CC1101_STX)
@@ -148,31 +284,25 @@ void iohub_cc1101_reset(cc1101_ctx *aCtx);
 	Bit 3:0  = FIFO_BYTES_AVAILABLE[3:0]
   */
 
-ret_code_t iohub_cc1101_check_status(const char *aFct, u8 aStatus)
+static ret_code_t iohub_cc1101_check_status(cc1101_ctx *aCtx, u8 aHeader, u8 aStatus)
 {
-	//LOG_DEBUG_CC1101("%s Status (n-1): 0x%x", aFct, aStatus);
-
-	/*switch ((aStatus >> 4) & 0x07)
-	{
-		case 0x00: LOG_DEBUG_CC1101("IDLE"); break;
-		case 0x01: LOG_DEBUG_CC1101("RX"); break;
-		case 0x02: LOG_DEBUG_CC1101("TX"); break;
-		case 0x03: LOG_DEBUG_CC1101("FSTXON"); break;
-		case 0x04: LOG_DEBUG_CC1101("STARTCAL"); break;
-		case 0x05: LOG_DEBUG_CC1101("SETTLING"); break;
-		case 0x06: LOG_DEBUG_CC1101("RXFIFO_OVERFLOW"); break;
-		case 0x07: LOG_DEBUG_CC1101("TXFIFO_UNDERFLOW"); break;
-		default:   LOG_DEBUG_CC1101("UNKNOWN"); break;
-	}
-  
-	LOG_DEBUG_CC1101("");
-	
-	if ( (aStatus & 0x80) != 0x00 )
+	if ( (aStatus & CC1101_STATUS_CHIP_RDYn) != 0x00 )
 	{
-		IOHUB_LOG_ERROR("Error: Chipset not ready, something goes wrong !");
+		LOG_ERROR_CC1101("Error: Chipset not ready, something goes wrong !");
+		aCtx->mfStatusValid = FALSE;
 		return E_INVALID_STATE;
 	}
-	*/
+
+	aCtx->mStatus = aStatus;
+	aCtx->mStatusTimeUs = iohub_time_now_us();
+	aCtx->mfStatusValid = TRUE;
+
+		//FIFO_BYTES_AVAILABLE is the RX FIFO fill level on reads, the TX FIFO free space on writes
+	if (aHeader & READ_SINGLE)
+		aCtx->mRxFifoBytes = CC1101_STATUS_FIFO_BYTES(aStatus);
+	else
+		aCtx->mTxFifoFree = CC1101_STATUS_FIFO_BYTES(aStatus);
+
 	return SUCCESS;
 }
 
@@ -215,23 +345,35 @@ void iohub_cc1101_print_state(u8 aState)
 
 /* -------------------------------------------------------------- */
 
+static inline void iohub_cc1101_select(cc1101_ctx *aCtx)
+{
+	aCtx->mSPITransactionCount++;
+	iohub_spi_select(&aCtx->mSPICtx);
+}
+
+/* -------------------------------------------------------------- */
+
+static inline void iohub_cc1101_deselect(cc1101_ctx *aCtx)
+{
+	iohub_spi_deselect(&aCtx->mSPICtx);
+}
+
+/* -------------------------------------------------------------- */
+
 u8 iohub_cc1101_read_reg(cc1101_ctx *aCtx, u8 aRegAddr, u8 aType) 
 {
 	IOHUB_ASSERT(aCtx->mWakeupCount > 0);
 	
-	iohub_spi_select(&aCtx->mSPICtx);
+	iohub_cc1101_select(aCtx);
 
 	u8 theReg = aRegAddr | aType;
 	u8 theValue = 0x00;
 	
-	ret_code_t lErr = iohub_cc1101_check_status( __FUNCTION__, iohub_spi_transfer_byte(&aCtx->mSPICtx, theReg) );
-	if (lErr == SUCCESS)
-	{
-		iohub_time_delay_us(10);  // Wait for chipset to be ready
+	ret_code_t lErr = iohub_cc1101_check_status(aCtx, theReg, iohub_spi_transfer_byte(&aCtx->mSPICtx, theReg));
+	if (lErr == SUCCESS) //Chip readiness is CHIP_RDYn, checked on select (SPIMode_WaitForMisoLowAfterSelect)
 		theValue = iohub_spi_transfer_byte(&aCtx->mSPICtx, 0x00);
-	}
 	
-	iohub_spi_deselect(&aCtx->mSPICtx);
+	iohub_cc1101_deselect(aCtx);
 		
 	//LOG_DEBUG_CC1101("Read register 0x%X = 0x%X", aRegAddr, theValue);
 	
@@ -249,6 +391,9 @@ u8 iohub_cc1101_read_status_reg(cc1101_ctx *aCtx, u8 aRegAddr)
 
 u8 iohub_cc1101_read_config_reg(cc1101_ctx *aCtx, u8 aRegAddr) 
 {
+	if (aCtx->mfRegsValid && aRegAddr < CC1101_REGISTERS_COUNT && !CC1101_IS_VOLATILE_REG(aRegAddr))
+		return aCtx->mRegs[aRegAddr];
+
 	return iohub_cc1101_read_reg(aCtx, aRegAddr, CC1101_CONFIG_REGISTER);
 }
 
@@ -256,15 +401,21 @@ u8 iohub_cc1101_read_config_reg(cc1101_ctx *aCtx, u8 aRegAddr)
 
 ret_code_t iohub_cc1101_strobe(cc1101_ctx *aCtx, u8 aStrobe)
 {
-	LOG_DEBUG_CC1101("Write strobe %x", aStrobe);
+	BOOL theIsNop = ((aStrobe & 0x3F) == CC1101_SNOP);
+
+	if (!theIsNop)
+		LOG_DEBUG_CC1101("Write strobe %x", aStrobe);
 	
 	//IOHUB_ASSERT(aCtx->mWakeupCount > 0);
 	
-	iohub_spi_select(&aCtx->mSPICtx);
+	iohub_cc1101_select(aCtx);
 
-	ret_code_t theRet = iohub_cc1101_check_status( __FUNCTION__, iohub_spi_transfer_byte(&aCtx->mSPICtx, aStrobe) );
+	ret_code_t theRet = iohub_cc1101_check_status(aCtx, aStrobe, iohub_spi_transfer_byte(&aCtx->mSPICtx, aStrobe));
 	
-	iohub_spi_deselect(&aCtx->mSPICtx);
+	iohub_cc1101_deselect(aCtx);
+
+	if (!theIsNop) //State is about to change, the returned byte describes the previous one
+		aCtx->mfStatusValid = FALSE;
 	
 	return theRet;
 }
@@ -275,13 +426,13 @@ ret_code_t iohub_cc1101_read_burst_reg(cc1101_ctx *aCtx, u8 aRegAddr, u8 *aBuffe
 {
 	IOHUB_ASSERT(aCtx->mWakeupCount > 0);
 	
-    iohub_spi_select(&aCtx->mSPICtx);
+    iohub_cc1101_select(aCtx);
 
-    ret_code_t lErr = iohub_cc1101_check_status( __FUNCTION__, iohub_spi_transfer_byte(&aCtx->mSPICtx, aRegAddr | READ_BURST) );
+    ret_code_t lErr = iohub_cc1101_check_status(aCtx, aRegAddr | READ_BURST, iohub_spi_transfer_byte(&aCtx->mSPICtx, aRegAddr | READ_BURST));
 	if (lErr == SUCCESS)
 		lErr = iohub_spi_transfer(&aCtx->mSPICtx, aBuffer, aLength);
 
-    iohub_spi_deselect(&aCtx->mSPICtx);
+    iohub_cc1101_deselect(aCtx);
 	
 	return lErr;
 }
@@ -292,15 +443,26 @@ ret_code_t iohub_cc1101_write_reg(cc1101_ctx *aCtx, u8 aRegAddr, u8 aValue)
 {
 	IOHUB_ASSERT(aCtx->mWakeupCount > 0);
 	
+	if (aRegAddr < CC1101_REGISTERS_COUNT && aCtx->mfRegsValid)
+	{
+		BOOL theUnchanged = (aCtx->mRegs[aRegAddr] == aValue && (aCtx->mDirtyRegs & (1ULL << aRegAddr)) == 0);
+
+		if (theUnchanged && !CC1101_IS_VOLATILE_REG(aRegAddr))
+			return SUCCESS;
+
+		aCtx->mRegs[aRegAddr] = aValue;
+		aCtx->mDirtyRegs &= ~(1ULL << aRegAddr);
+	}
+
 	LOG_DEBUG_CC1101("Write reg 0x%X -> 0x%X", aRegAddr, aValue);
 	
-	iohub_spi_select(&aCtx->mSPICtx);
+	iohub_cc1101_select(aCtx);
 
-	ret_code_t lErr = iohub_cc1101_check_status( __FUNCTION__,  iohub_spi_transfer_byte(&aCtx->mSPICtx, aRegAddr));
+	ret_code_t lErr = iohub_cc1101_check_status(aCtx, aRegAddr, iohub_spi_transfer_byte(&aCtx->mSPICtx, aRegAddr));
 	if (lErr == SUCCESS)
 		lErr = iohub_spi_transfer(&aCtx->mSPICtx, &aValue, 1);
 	
-	iohub_spi_deselect(&aCtx->mSPICtx);
+	iohub_cc1101_deselect(aCtx);
 	
 	return lErr;
 }
@@ -313,55 +475,325 @@ ret_code_t iohub_cc1101_write_burst_reg(cc1101_ctx *aCtx, u8 aRegAddr, u8 *aBuff
 	
 	LOG_DEBUG_CC1101("Write burst reg %x (len: %d)", aRegAddr | WRITE_BURST, aLength);
 	
-    iohub_spi_select(&aCtx->mSPICtx);
+    iohub_cc1101_select(aCtx);
 
-    ret_code_t lErr = iohub_cc1101_check_status( __FUNCTION__, iohub_spi_transfer_byte(&aCtx->mSPICtx, aRegAddr | WRITE_BURST) );
+    ret_code_t lErr = iohub_cc1101_check_status(aCtx, aRegAddr | WRITE_BURST, iohub_spi_transfer_byte(&aCtx->mSPICtx, aRegAddr | WRITE_BURST));
 	if (lErr == SUCCESS)
 		lErr = iohub_spi_transfer(&aCtx->mSPICtx, aBuffer, aLength);
 
-    iohub_spi_deselect(&aCtx->mSPICtx);
+		//Each data byte is answered with a status byte too, keep the latest
+	if (lErr == SUCCESS && aLength > 0)
+		(void)iohub_cc1101_check_status(aCtx, aRegAddr | WRITE_BURST, aBuffer[aLength - 1]);
+
+    iohub_cc1101_deselect(aCtx);
 	
 	return lErr;
 }
 	
 /* -------------------------------------------------------------- */
 
-BOOL iohub_cc1101_wait_for_state(cc1101_ctx *aCtx, u8 aState, u32 aTimeoutMS)
+	//MARCSTATE value for each STATE[2:0] of the status byte, 0xFF when several states share the code
+static const u8 sStatusToState[8] = 
 {
-	u32 theStartTimeMs = IOHUB_TIMER_START();
-	
-	while(IOHUB_TIMER_ELAPSED(theStartTimeMs) < aTimeoutMS)
+	STATE_IDLE,
+	STATE_RX,
+	STATE_TX,
+	STATE_FSTXON,
+	0xFF, //CALIBRATE
+	0xFF, //SETTLING
+	STATE_RXFIFO_OVERFLOW,
+	STATE_TXFIFO_UNDERFLOW
+};
+
+/* -------------------------------------------------------------- */
+
+static inline BOOL iohub_cc1101_is_status_fresh(cc1101_ctx *aCtx)
+{
+	return (aCtx->mfStatusValid && (iohub_time_now_us() - aCtx->mStatusTimeUs) < CC1101_STATUS_FRESH_US) ? TRUE : FALSE;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Single byte SNOP with the read bit: returns state and RX FIFO level in one transfer
+static inline void iohub_cc1101_refresh_status(cc1101_ctx *aCtx)
+{
+	(void)iohub_cc1101_strobe(aCtx, CC1101_SNOP | READ_SINGLE);
+}
+
+/* -------------------------------------------------------------- */
+
+u8 iohub_cc1101_get_state(cc1101_ctx *aCtx)
+{
+	if (iohub_cc1101_is_status_fresh(aCtx))
+	{
+		u8 theState = sStatusToState[CC1101_STATUS_STATE(aCtx->mStatus)];
+		if (theState != 0xFF)
+			return theState;
+	}
+
+	return iohub_cc1101_read_status_reg(aCtx, CC1101_MARCSTATE) & 0x1F;
+}
+
+/* -------------------------------------------------------------- */
+
+static inline BOOL iohub_cc1101_has_gdo0(cc1101_ctx *aCtx)
+{
+	return (aCtx->mGDO0Pin != IOHUB_GPIO_PIN_INVALID) ? TRUE : FALSE;
+}
+
+/* -------------------------------------------------------------- */
+
+static cc1101_transition_stats *iohub_cc1101_transition_stats(cc1101_ctx *aCtx, u8 aState)
+{
+	switch (aState)
+	{
+		case STATE_IDLE:		return &aCtx->mTransitions[CC1101Transition_Idle];
+		case STATE_RX:			return &aCtx->mTransitions[CC1101Transition_Rx];
+		case STATE_TX:			return &aCtx->mTransitions[CC1101Transition_Tx];
+		case STATE_FSTXON:		return &aCtx->mTransitions[CC1101Transition_FsTxOn];
+		default:				return &aCtx->mTransitions[CC1101Transition_Other];
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+	//afEndOfPacket: a packet is being sent, GDO0 (IOCFG0 = 0x06) de-asserts when it is over so the
+	//wait costs no SPI traffic while on air. The event must have been cleared before STX
+static BOOL iohub_cc1101_wait_state(cc1101_ctx *aCtx, u8 aState, u32 aTimeoutMS, BOOL afEndOfPacket)
+{
+	cc1101_transition_stats *theStats = iohub_cc1101_transition_stats(aCtx, aState);
+	uint64_t 	theStartUs = iohub_time_now_us();
+	uint64_t 	theTimeoutUs = (uint64_t)aTimeoutMS * 1000;
+	uint64_t 	theElapsedUs;
+	u32 		theDelayUs = (theStats->mCount > 0) ? (u32)((theStats->mTotalUs / theStats->mCount) * 3 / 4) : 0;
+	BOOL 		theStatusOnly = FALSE;
+	BOOL 		theReached = FALSE;
+
+		//States visible in the status byte are polled with a 1 byte SNOP instead of a MARCSTATE read
+	for (u8 i=0; i<sizeof(sStatusToState); i++)
+	{
+		if (sStatusToState[i] == aState)
+			theStatusOnly = TRUE;
+	}
+
+	if (afEndOfPacket && iohub_cc1101_has_gdo0(aCtx) && aCtx->mRegs[CC1101_IOCFG0] == CC1101_IOCFG_SYNC_OR_END)
 	{
+		if (iohub_event_wait(&aCtx->mRxEvent, aTimeoutMS))
+		{
+			theStats->mEventCount++;
+			theDelayUs = 0;
+		}
+	}
+
+	for (;;)
+	{
+		if (theDelayUs > 0)
+		{
+			theElapsedUs = iohub_time_now_us() - theStartUs;
+			if (theElapsedUs < theTimeoutUs)
+				iohub_time_delay_us((u32)MIN((uint64_t)theDelayUs, theTimeoutUs - theElapsedUs));
+		}
+
+		if (theStatusOnly)
+			iohub_cc1101_refresh_status(aCtx);
+
+		theStats->mPollCount++;
+
 		if (getState(aCtx) == aState)
-			return TRUE;
+		{
+			theReached = TRUE;
+			break;
+		}
+
+		if ((uint64_t)(iohub_time_now_us() - theStartUs) >= theTimeoutUs)
+			break;
 
-		iohub_time_delay_ms(1);
+		theDelayUs = (theDelayUs < CC1101_STATE_POLL_MIN_US) ? CC1101_STATE_POLL_MIN_US : MIN(theDelayUs * 2, CC1101_STATE_POLL_MAX_US);
 	}
-	
-	return FALSE;
+
+	theElapsedUs = iohub_time_now_us() - theStartUs;
+
+	if (!theReached)
+	{
+		theStats->mTimeoutCount++;
+		LOG_ERROR_CC1101("State 0x%02X not reached after %lu us", aState, (u32)theElapsedUs);
+		return FALSE;
+	}
+
+	theStats->mLastUs = (u32)theElapsedUs;
+	theStats->mTotalUs += theElapsedUs;
+	if (theStats->mCount == 0 || theStats->mLastUs < theStats->mMinUs)
+		theStats->mMinUs = theStats->mLastUs;
+	if (theStats->mLastUs > theStats->mMaxUs)
+		theStats->mMaxUs = theStats->mLastUs;
+	theStats->mCount++;
+
+	return TRUE;
 }
-	
+
+/* -------------------------------------------------------------- */
+
+BOOL iohub_cc1101_wait_for_state(cc1101_ctx *aCtx, u8 aState, u32 aTimeoutMS)
+{
+	return iohub_cc1101_wait_state(aCtx, aState, aTimeoutMS, FALSE);
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_get_transition_stats(cc1101_ctx *aCtx, CC1101Transition aTransition, cc1101_transition_stats *aStats)
+{
+	memcpy(aStats, &aCtx->mTransitions[aTransition], sizeof(cc1101_transition_stats));
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_reset_transition_stats(cc1101_ctx *aCtx)
+{
+	memset(aCtx->mTransitions, 0x00, sizeof(aCtx->mTransitions));
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_dump_transition_stats(cc1101_ctx *aCtx)
+{
+	static const char *sNames[CC1101Transition_Count] = { "IDLE", "RX", "TX", "FSTXON", "other" };
+
+	for (u8 i=0; i<CC1101Transition_Count; i++)
+	{
+		const cc1101_transition_stats *theStats = &aCtx->mTransitions[i];
+
+		if (theStats->mCount == 0 && theStats->mTimeoutCount == 0)
+			continue;
+
+		IOHUB_LOG_INFO("CC1101 -> %-6s: count=%lu mean=%lu us min=%lu us max=%lu us polls=%lu gdo=%lu timeouts=%lu",
+						sNames[i],
+						theStats->mCount,
+						(theStats->mCount > 0) ? (u32)(theStats->mTotalUs / theStats->mCount) : 0,
+						theStats->mMinUs,
+						theStats->mMaxUs,
+						theStats->mPollCount,
+						theStats->mEventCount,
+						theStats->mTimeoutCount);
+	}
+}
+
 /* -------------------------------------------------------------- */
 
+	//GDO0 (IOCFG0 = 0x06) de-asserts at the end of the packet, keep the ISR short: no SPI, no logs
 static void IRAM_ATTR iohub_cc1101_interrupt_data_received(void *arg) 
 {
-	LOG_DEBUG_CC1101("PIN TRIGGERED!!!");
-    //packetReceived = true;
+	cc1101_ctx *theCtx = (cc1101_ctx *)arg;
+
+		//GDO0 is left floating in asynchronous serial mode
+	if (theCtx->mAsyncReceiver != NULL)
+		return;
+
+	theCtx->mRxEventTimeUs = iohub_time_now_us();
+
+	if (theCtx->mRxPendingCount < 0xFF)
+		theCtx->mRxPendingCount++;
+
+	iohub_event_signal_from_isr(&theCtx->mRxEvent);
 }
 
 /* -------------------------------------------------------------- */
 
-ret_code_t iohub_cc1101_init(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDefaultConfig[CC1101_REGISTERS_COUNT], u8 aFirstBytePaTable)
+static inline void iohub_cc1101_clear_rx_event(cc1101_ctx *aCtx)
 {
-	ret_code_t   theRet;
+	aCtx->mRxPendingCount = 0;
+	iohub_event_clear(&aCtx->mRxEvent);
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Upload the configuration with as few transactions as possible: one burst per run of
+	consecutive registers, a run being broken by 0xFF (don't care) entries only.
+	Burst transfers are full duplex in place, the config is copied before being sent.
+*/
+static ret_code_t iohub_cc1101_write_config(cc1101_ctx *aCtx, const u8 aConfig[CC1101_REGISTERS_COUNT])
+{
+	u8 			theBuffer[CC1101_REGISTERS_COUNT];
+	ret_code_t	theRet = SUCCESS;
+	u8			theStart = 0;
+
+	while (theStart < CC1101_REGISTERS_COUNT && theRet == SUCCESS)
+	{
+		if (aConfig[theStart] == 0xFF)
+		{
+			theStart++;
+			continue;
+		}
+
+		u8 theEnd = theStart;
+		while (theEnd < CC1101_REGISTERS_COUNT && aConfig[theEnd] != 0xFF)
+			theEnd++;
+
+		memcpy(theBuffer, &aConfig[theStart], theEnd - theStart);
+		theRet = iohub_cc1101_write_burst_reg(aCtx, theStart, theBuffer, theEnd - theStart);
+
+		theStart = theEnd;
+	}
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+static ret_code_t iohub_cc1101_verify_config(cc1101_ctx *aCtx, const u8 aConfig[CC1101_REGISTERS_COUNT], BOOL afLogErrors)
+{
+	u8 			theBuffer[CC1101_REGISTERS_COUNT];
+	ret_code_t	theRet;
+
+	memset(theBuffer, 0x00, sizeof(theBuffer));
+
+	theRet = iohub_cc1101_read_burst_reg(aCtx, 0x00, theBuffer, sizeof(theBuffer));
+	if (theRet != SUCCESS)
+		return theRet;
 
+	for (u8 i=0; i<CC1101_REGISTERS_COUNT; i++)
+	{
+		if (aConfig[i] != 0xFF && theBuffer[i] != aConfig[i])
+		{
+			if (afLogErrors)
+				LOG_ERROR_CC1101("Config reg 0x%02X: wrote 0x%02X, read 0x%02X", i, aConfig[i], theBuffer[i]);
+			theRet = E_INVALID_DATA;
+		}
+	}
+
+		//Readback is what the chip really holds, including reset values of don't care entries
+	memcpy(aCtx->mRegs, theBuffer, sizeof(aCtx->mRegs));
+	aCtx->mDirtyRegs = 0;
+	aCtx->mfRegsValid = (theRet == SUCCESS);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Host side only, the chip is not accessed
+static ret_code_t iohub_cc1101_init_ctx(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin)
+{
 	memset(aCtx, 0x00, sizeof(cc1101_ctx));
 
 	aCtx->mGDO0Pin = aGDO0Pin;
+	aCtx->mGDO2Pin = IOHUB_GPIO_PIN_INVALID;
+	iohub_event_init(&aCtx->mRxEvent);
 	
-	iohub_digital_set_pin_mode(aCtx->mGDO0Pin, PinMode_Input);
+	if (iohub_cc1101_has_gdo0(aCtx))
+		iohub_digital_set_pin_mode(aCtx->mGDO0Pin, PinMode_Input);
     
-	theRet = iohub_spi_init(&aCtx->mSPICtx, aCSnPin, SPIMode_WaitForMisoLowAfterSelect);
+	return iohub_spi_init(&aCtx->mSPICtx, aCSnPin, SPIMode_WaitForMisoLowAfterSelect);
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_init(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDefaultConfig[CC1101_REGISTERS_COUNT], u8 aFirstBytePaTable)
+{
+	ret_code_t   theRet;
+	uint64_t	 theStartTimeUs = iohub_time_now_us();
+
+	theRet = iohub_cc1101_init_ctx(aCtx, aCSnPin, aGDO0Pin);
 	if (theRet != SUCCESS)
 		return theRet;
     
@@ -380,10 +812,14 @@ ret_code_t iohub_cc1101_init(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDe
     }
 	
         //Set default configuration
-    for (u8 i=0; i<CC1101_REGISTERS_COUNT; i++) 
+	theRet = iohub_cc1101_write_config(aCtx, aDefaultConfig);
+	if (theRet == SUCCESS)
+		theRet = iohub_cc1101_verify_config(aCtx, aDefaultConfig, TRUE);
+
+	if (theRet != SUCCESS)
 	{
-		if (aDefaultConfig[i] != 0xFF)
-			iohub_cc1101_write_reg(aCtx, i,  aDefaultConfig[i]);
+		iohub_cc1101_standby(aCtx);
+		return theRet;
 	}
 		
 	/* 
@@ -391,6 +827,7 @@ ret_code_t iohub_cc1101_init(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDe
 	Note that the content of the PATABLE is lost when entering the SLEEP state, except for the first byte (index 0).
 	*/
 		
+	aCtx->mPaTable = aFirstBytePaTable;
 	iohub_cc1101_write_burst_reg(aCtx, CC1101_PATABLE, &aFirstBytePaTable, sizeof(aFirstBytePaTable));		//CC1101 PATABLE config
 	
 	setIdleState(aCtx);
@@ -400,7 +837,80 @@ ret_code_t iohub_cc1101_init(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDe
 	flushRxFifo(aCtx);
 	flushTxFifo(aCtx);
 	
-	return iohub_cc1101_standby(aCtx);
+	theRet = iohub_cc1101_standby(aCtx);
+
+	aCtx->mInitTimeUs = (u32)(iohub_time_now_us() - theStartTimeUs);
+	LOG_DEBUG_CC1101("CC1101 init done in %lu us (%lu SPI transactions)", aCtx->mInitTimeUs, aCtx->mSPITransactionCount);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Warm init
+	======================
+	The chip keeps its registers while the host process restarts. Version, configuration and
+	PATABLE[0] are read back (3 transactions, the configuration in one burst) without going through
+	wakeup(), which would idle the radio and flush its FIFOs. FSCAL3/2/1 hold calibration results and
+	are not compared. On any difference the regular iohub_cc1101_init() runs.
+	A radio found in RX, or with packets in its RX FIFO, keeps receiving: the context then holds one
+	wakeup that standby() releases, and the packets are pending for the next receive.
+*/
+
+ret_code_t iohub_cc1101_init_warm(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDefaultConfig[CC1101_REGISTERS_COUNT], u8 aFirstBytePaTable, BOOL *afResumed)
+{
+	u8 			theConfig[CC1101_REGISTERS_COUNT];
+	u8 			thePaTable = 0x00;
+	uint64_t	theStartTimeUs = iohub_time_now_us();
+	ret_code_t	theRet;
+
+	*afResumed = FALSE;
+
+	theRet = iohub_cc1101_init_ctx(aCtx, aCSnPin, aGDO0Pin);
+	if (theRet != SUCCESS)
+		return theRet;
+
+	memcpy(theConfig, aDefaultConfig, sizeof(theConfig));
+	theConfig[CC1101_FSCAL3] = theConfig[CC1101_FSCAL2] = theConfig[CC1101_FSCAL1] = 0xFF;
+
+		//Awake without wakeup(): selecting the chip is enough to bring it out of SLEEP (WOR included) to IDLE
+	aCtx->mWakeupCount = 1;
+
+	if (iohub_cc1101_read_status_reg(aCtx, CC1101_VERSION) != 0x14 ||
+		iohub_cc1101_verify_config(aCtx, theConfig, FALSE) != SUCCESS ||
+		iohub_cc1101_read_burst_reg(aCtx, CC1101_PATABLE, &thePaTable, sizeof(thePaTable)) != SUCCESS ||
+		thePaTable != aFirstBytePaTable)
+	{
+		LOG_DEBUG_CC1101("CC1101 configuration differs, cold init");
+
+		iohub_spi_uninit(&aCtx->mSPICtx);
+		iohub_event_uninit(&aCtx->mRxEvent);
+
+		return iohub_cc1101_init(aCtx, aCSnPin, aGDO0Pin, aDefaultConfig, aFirstBytePaTable);
+	}
+
+	aCtx->mPaTable = aFirstBytePaTable;
+
+		//A packet received before the restart may wait in the FIFO, RXOFF_MODE may have left RX already
+	if ((iohub_cc1101_read_status_reg(aCtx, CC1101_RXBYTES) & 0x7F) > 0)
+		aCtx->mRxPendingCount = 1;
+
+	if (getState(aCtx) == STATE_RX || aCtx->mRxPendingCount > 0)
+	{
+		if (iohub_cc1101_has_gdo0(aCtx))
+			iohub_attach_interrupt(aCtx->mGDO0Pin, iohub_cc1101_interrupt_data_received, IOHUB_GPIO_INT_TYPE_FALLING, aCtx);
+	}
+	else
+		theRet = iohub_cc1101_standby(aCtx);
+
+	*afResumed = TRUE;
+
+	aCtx->mInitTimeUs = (u32)(iohub_time_now_us() - theStartTimeUs);
+	LOG_DEBUG_CC1101("CC1101 warm init done in %lu us (%lu SPI transactions, %s)", aCtx->mInitTimeUs, aCtx->mSPITransactionCount,
+					 (aCtx->mWakeupCount > 0) ? "still receiving" : "standby");
+
+	return theRet;
 }
 
 /* -------------------------------------------------------------- */
@@ -408,6 +918,7 @@ ret_code_t iohub_cc1101_init(cc1101_ctx *aCtx, u32 aCSnPin, u32 aGDO0Pin, u8 aDe
 void iohub_cc1101_uninit(cc1101_ctx *aCtx)
 {
     iohub_spi_uninit(&aCtx->mSPICtx);
+	iohub_event_uninit(&aCtx->mRxEvent);
 }
 
 /* -------------------------------------------------------------- */
@@ -428,16 +939,19 @@ ret_code_t iohub_cc1101_wakeup(cc1101_ctx *aCtx)
 	{
 		LOG_DEBUG_CC1101("Wakeup CC1101 ...");
 		
-		iohub_spi_select(&aCtx->mSPICtx); //Low
+		iohub_cc1101_select(aCtx); //Low
 		iohub_time_delay_us(10);
-		iohub_spi_deselect(&aCtx->mSPICtx); //High
+		iohub_cc1101_deselect(aCtx); //High
 		iohub_time_delay_us(40);
 
 		setIdleState(aCtx);
 		flushRxFifo(aCtx);
 		flushTxFifo(aCtx);
 
-		iohub_attach_interrupt(aCtx->mGDO0Pin, iohub_cc1101_interrupt_data_received, IOHUB_GPIO_INT_TYPE_RISING, NULL);
+		iohub_cc1101_clear_rx_event(aCtx);
+
+		if (iohub_cc1101_has_gdo0(aCtx))
+			iohub_attach_interrupt(aCtx->mGDO0Pin, iohub_cc1101_interrupt_data_received, IOHUB_GPIO_INT_TYPE_FALLING, aCtx);
 	}
 
 	IOHUB_ASSERT(aCtx->mWakeupCount < 5);
@@ -453,7 +967,8 @@ ret_code_t iohub_cc1101_standby(cc1101_ctx *aCtx)
 	{
 		LOG_DEBUG_CC1101("Standby CC1101 ...");
 		
-		iohub_detach_interrupt(aCtx->mGDO0Pin);
+		if (iohub_cc1101_has_gdo0(aCtx))
+			iohub_detach_interrupt(aCtx->mGDO0Pin);
 	
 		setIdleState(aCtx);	
 		setPowerDown(aCtx);
@@ -466,124 +981,2036 @@ ret_code_t iohub_cc1101_standby(cc1101_ctx *aCtx)
 
 /* -------------------------------------------------------------- */
 
-ret_code_t iohub_cc1101_send_data(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket)
-{
-	LOG_DEBUG_CC1101("iohub_cc1101_send %d bytes...", aPacket->mLength);
-	
-	u8 theBuffer[32] = {0x00};
+/*
+	FIFO streaming
+	======================
+	Packets longer than the 64 bytes FIFO are pushed / drained while on air. The FIFO level is
+	known from GDO2 configured as a threshold signal when the pin is wired, from TXBYTES / RXBYTES
+	otherwise.
+*/
 
-	iohub_cc1101_wakeup(aCtx);
+static u8 iohub_cc1101_read_fifo_bytes(cc1101_ctx *aCtx, u8 aRegAddr)
+{
+	u8 theValue = iohub_cc1101_read_status_reg(aCtx, aRegAddr);
 
-	theBuffer[0] = aPacket->mLength;
-	theBuffer[1] = aPacket->mDst;
-	memcpy(&theBuffer[2], aPacket->mData, aPacket->mLength);
+		//Errata: RXBYTES / TXBYTES may be wrong while the FIFO is updated, read until stable
+	for (;;)
+	{
+		u8 theCheck = iohub_cc1101_read_status_reg(aCtx, aRegAddr);
+		if (theCheck == theValue)
+			return theValue;
 
-    iohub_cc1101_write_burst_reg(aCtx, CC1101_TXFIFO, theBuffer, aPacket->mLength + 2);
+		theValue = theCheck;
+	}
+}
 
-	setTxState(aCtx);
-	
-	(void)iohub_cc1101_wait_for_state(aCtx, STATE_IDLE, 1000);
+/* -------------------------------------------------------------- */
 
-    return iohub_cc1101_standby(aCtx);
+static inline BOOL iohub_cc1101_has_gdo2(cc1101_ctx *aCtx)
+{
+	return (aCtx->mGDO2Pin != IOHUB_GPIO_PIN_INVALID) ? TRUE : FALSE;
 }
 
 /* -------------------------------------------------------------- */
 
-BOOL iohub_cc1101_is_data_available(cc1101_ctx *aCtx)
+	//Threshold signals are only meaningful with the streaming FIFOTHR, both are restored by stream_end()
+static void iohub_cc1101_stream_begin(cc1101_ctx *aCtx, u8 anIOCfg, u8 aPktCtrl0, u8 aPktLen)
 {
-	IOHUB_ASSERT(aCtx->mWakeupCount > 0);
-
-	u8 theValue = iohub_cc1101_read_status_reg(aCtx, CC1101_RXBYTES);
-	if (theValue > 0)
+	if (iohub_cc1101_has_gdo2(aCtx))
 	{
-		u8 theState = getState(aCtx);
-		
-		if (theState == STATE_IDLE || theState == STATE_RXFIFO_OVERFLOW) //Device will automatically enter in IDLE state when it will fully receive a message
-			return TRUE;
+		iohub_cc1101_set_reg(aCtx, CC1101_IOCFG2, anIOCfg);
+		iohub_cc1101_set_reg(aCtx, CC1101_FIFOTHR, (aCtx->mRegs[CC1101_FIFOTHR] & ~CC1101_FIFOTHR_MASK) | CC1101_FIFOTHR_STREAM);
+	}
+
+	iohub_cc1101_set_reg(aCtx, CC1101_PKTCTRL0, aPktCtrl0);
+	iohub_cc1101_set_reg(aCtx, CC1101_PKTLEN, aPktLen);
+
+	(void)iohub_cc1101_flush_regs(aCtx);
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_stream_end(cc1101_ctx *aCtx, const u8 aSavedRegs[4])
+{
+	iohub_cc1101_set_reg(aCtx, CC1101_IOCFG2, aSavedRegs[0]);
+	iohub_cc1101_set_reg(aCtx, CC1101_FIFOTHR, aSavedRegs[1]);
+	iohub_cc1101_set_reg(aCtx, CC1101_PKTCTRL0, aSavedRegs[2]);
+	iohub_cc1101_set_reg(aCtx, CC1101_PKTLEN, aSavedRegs[3]);
+
+	(void)iohub_cc1101_flush_regs(aCtx);
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_stream_save(cc1101_ctx *aCtx, u8 aSavedRegs[4])
+{
+	aSavedRegs[0] = aCtx->mRegs[CC1101_IOCFG2];
+	aSavedRegs[1] = aCtx->mRegs[CC1101_FIFOTHR];
+	aSavedRegs[2] = aCtx->mRegs[CC1101_PKTCTRL0];
+	aSavedRegs[3] = aCtx->mRegs[CC1101_PKTLEN];
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Hardware packet filtering
+	======================
+	Address (ADR_CHK / ADDR), length (PKTLEN in variable length mode) and CRC (CRC_AUTOFLUSH) checks
+	run in the chip. GDO0 (IOCFG0 = 0x06) still de-asserts for a dropped packet, so an end of packet
+	edge finding the RX FIFO empty is counted as a drop without reading anything out.
+*/
+
+ret_code_t iohub_cc1101_filter_to_config(const cc1101_filter *aFilter, u8 aConfig[CC1101_REGISTERS_COUNT])
+{
+	if (aFilter->mAddressCheck > CC1101AddressCheck_Broadcast00FF)
+		return E_INVALID_PARAMETERS;
+
+		//CRC_AUTOFLUSH works on a single packet in the FIFO, streamed ones are never checked
+	if (aFilter->mfCrcAutoFlush)
+	{
+		u16 theMaxLen = ((aFilter->mMaxLength != 0) ? aFilter->mMaxLength : aConfig[CC1101_PKTLEN]) + 1;
+
+		if (aConfig[CC1101_PKTCTRL1] & CC1101_PKTCTRL1_APPEND_STATUS)
+			theMaxLen += 2;
+
+		if (!(aConfig[CC1101_PKTCTRL0] & CC1101_PKTCTRL0_CRC_EN) || theMaxLen > CC1101_BUFFER_LEN)
+			return E_NOT_SUPPORTED;
+	}
+
+	aConfig[CC1101_PKTCTRL1] = (aConfig[CC1101_PKTCTRL1] & ~(CC1101_PKTCTRL1_ADR_CHK_MASK | CC1101_PKTCTRL1_CRC_AUTOFLUSH)) |
+							   (u8)aFilter->mAddressCheck |
+							   (aFilter->mfCrcAutoFlush ? CC1101_PKTCTRL1_CRC_AUTOFLUSH : 0);
+	aConfig[CC1101_ADDR] = aFilter->mAddress;
+
+	if (aFilter->mMaxLength != 0)
+		aConfig[CC1101_PKTLEN] = aFilter->mMaxLength;
+
+	return SUCCESS;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_set_filter(cc1101_ctx *aCtx, const cc1101_filter *aFilter)
+{
+	u8 			theConfig[CC1101_REGISTERS_COUNT];
+	ret_code_t 	theRet;
+
+	if (aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+		//Filtering applies to what the FIFO holds, checked on a copy of the shadow
+	memcpy(theConfig, aCtx->mRegs, sizeof(theConfig));
+
+	theRet = iohub_cc1101_filter_to_config(aFilter, theConfig);
+	if (theRet != SUCCESS)
+		return theRet;
+
+	iohub_cc1101_set_reg(aCtx, CC1101_PKTCTRL1, theConfig[CC1101_PKTCTRL1]);
+	iohub_cc1101_set_reg(aCtx, CC1101_ADDR, theConfig[CC1101_ADDR]);
+	iohub_cc1101_set_reg(aCtx, CC1101_PKTLEN, theConfig[CC1101_PKTLEN]);
+
+	return iohub_cc1101_flush_regs(aCtx);
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_get_filter(cc1101_ctx *aCtx, cc1101_filter *aFilter)
+{
+	aFilter->mAddressCheck = (CC1101AddressCheck)(aCtx->mRegs[CC1101_PKTCTRL1] & CC1101_PKTCTRL1_ADR_CHK_MASK);
+	aFilter->mAddress = aCtx->mRegs[CC1101_ADDR];
+	aFilter->mfCrcAutoFlush = (aCtx->mRegs[CC1101_PKTCTRL1] & CC1101_PKTCTRL1_CRC_AUTOFLUSH) ? TRUE : FALSE;
+	aFilter->mMaxLength = aCtx->mRegs[CC1101_PKTLEN];
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_get_filter_stats(cc1101_ctx *aCtx, cc1101_filter_stats *aStats)
+{
+	memcpy(aStats, &aCtx->mFilterStats, sizeof(cc1101_filter_stats));
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_reset_filter_stats(cc1101_ctx *aCtx)
+{
+	memset(&aCtx->mFilterStats, 0x00, sizeof(cc1101_filter_stats));
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Listen before talk
+	======================
+	With MCSM1.CCA_MODE set the chip only honours STX in RX when the channel is clear, otherwise it
+	stays in RX. The packet is loaded first, STX is repeated after random, growing backoffs.
+*/
+
+ret_code_t iohub_cc1101_set_cca(cc1101_ctx *aCtx, const cc1101_cca_settings *aSettings)
+{
+	if (aSettings != NULL && (aSettings->mMode == 0 || aSettings->mMode > 3 || aSettings->mRelativeThreshold > 3 ||
+							  aSettings->mAbsoluteThreshold < -8 || aSettings->mAbsoluteThreshold > 7 ||
+							  aSettings->mBackoffMaxUs < aSettings->mBackoffMinUs))
+		return E_INVALID_PARAMETERS;
+
+		//Sessions save / restore MCSM1 as a whole
+	if (aCtx->mfSessionActive || aCtx->mfWorActive || aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+	if (!aCtx->mfCCAEnabled)
+	{
+		if (aSettings == NULL)
+			return SUCCESS;
+
+		aCtx->mCCASavedRegs[0] = aCtx->mRegs[CC1101_MCSM1];
+		aCtx->mCCASavedRegs[1] = aCtx->mRegs[CC1101_AGCCTRL1];
+	}
+
+	if (aSettings == NULL)
+	{
+		iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, (aCtx->mRegs[CC1101_MCSM1] & ~CC1101_MCSM1_CCA_MASK) | (aCtx->mCCASavedRegs[0] & CC1101_MCSM1_CCA_MASK));
+		iohub_cc1101_set_reg(aCtx, CC1101_AGCCTRL1, aCtx->mCCASavedRegs[1]);
+		aCtx->mfCCAEnabled = FALSE;
+	}
+	else
+	{
+		memcpy(&aCtx->mCCA, aSettings, sizeof(cc1101_cca_settings));
+
+		iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, (aCtx->mRegs[CC1101_MCSM1] & ~CC1101_MCSM1_CCA_MASK) | (aSettings->mMode << CC1101_MCSM1_CCA_SHIFT));
+		iohub_cc1101_set_reg(aCtx, CC1101_AGCCTRL1, (aCtx->mCCASavedRegs[1] & ~(CC1101_AGCCTRL1_CS_REL_MASK | CC1101_AGCCTRL1_CS_ABS_MASK)) |
+													(aSettings->mRelativeThreshold << CC1101_AGCCTRL1_CS_REL_SHIFT) |
+													((u8)aSettings->mAbsoluteThreshold & CC1101_AGCCTRL1_CS_ABS_MASK));
+		aCtx->mfCCAEnabled = TRUE;
+	}
+
+	return iohub_cc1101_flush_regs(aCtx);
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_get_tx_report(cc1101_ctx *aCtx, cc1101_tx_report *aReport)
+{
+	memcpy(aReport, &aCtx->mTxReport, sizeof(cc1101_tx_report));
+}
+
+/* -------------------------------------------------------------- */
+
+	//xorshift32, seeded with the time of the first draw so that radios powered together diverge
+static u32 iohub_cc1101_random(cc1101_ctx *aCtx)
+{
+	u32 theState = aCtx->mRandomState;
+
+	if (theState == 0)
+		theState = (u32)iohub_time_now_us() | 1;
+
+	theState ^= theState << 13;
+	theState ^= theState >> 17;
+	theState ^= theState << 5;
+
+	return aCtx->mRandomState = theState;
+}
+
+/* -------------------------------------------------------------- */
+
+	//aLoaded bytes are in the TX FIFO. STX from RX until the chip accepts it or the budget is spent
+static ret_code_t iohub_cc1101_cca_start(cc1101_ctx *aCtx, u8 aLoaded)
+{
+	cc1101_tx_report 	*theReport = &aCtx->mTxReport;
+	u32 				theWindowUs = aCtx->mCCA.mBackoffMinUs;
+
+	for (;;)
+	{
+			//The assessment needs RX with a valid RSSI, a received packet may also have ended RX
+		if (getState(aCtx) != STATE_RX)
+		{
+			setRxState(aCtx);
+			if (!iohub_cc1101_wait_for_state(aCtx, STATE_RX, 2))
+				return E_TIMEOUT;
+
+			iohub_time_delay_us(CC1101_RSSI_SETTLE_US);
+		}
+
+		iohub_cc1101_clear_rx_event(aCtx);
+		setTxState(aCtx);
+		iohub_time_delay_us(CC1101_CCA_DECISION_US);
+
+			//Short packets may already be out: the TX FIFO tells
+		if (getState(aCtx) == STATE_TX || (iohub_cc1101_read_fifo_bytes(aCtx, CC1101_TXBYTES) & 0x7F) < aLoaded)
+			return SUCCESS;
+
+		theReport->mBusyRssiDbm = iohub_cc1101_rssi_to_dbm(iohub_cc1101_read_status_reg(aCtx, CC1101_RSSI));
+
+		if (theReport->mBackoffCount >= aCtx->mCCA.mMaxBackoffs)
+		{
+			LOG_DEBUG_CC1101("Channel busy (%d dBm), send given up after %u backoffs", theReport->mBusyRssiDbm, theReport->mBackoffCount);
+			return E_TIMEOUT;
+		}
+
+		u32 theDelayUs = iohub_cc1101_random(aCtx) % (theWindowUs + 1);
+
+		theReport->mBackoffCount++;
+		theReport->mBackoffUs += theDelayUs;
+
+		iohub_time_delay_us(theDelayUs);
+		theWindowUs = MIN(theWindowUs * 2, aCtx->mCCA.mBackoffMaxUs);
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+	//GDO2 only tells the TX FIFO room when stream_begin() routed the threshold signal to it
+static BOOL iohub_cc1101_has_tx_threshold(cc1101_ctx *aCtx)
+{
+	return (iohub_cc1101_has_gdo2(aCtx)
+			&& aCtx->mRegs[CC1101_IOCFG2] == CC1101_IOCFG_TX_THR
+			&& (aCtx->mRegs[CC1101_FIFOTHR] & CC1101_FIFOTHR_MASK) == CC1101_FIFOTHR_STREAM) ? TRUE : FALSE;
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Transmit aHeader + aData (on air bytes, length fields included).
+	In infinite mode PKTLEN must hold the total length modulo 256: the radio is switched to fixed
+	length once less than 256 bytes remain so it stops at the right byte.
+*/
+static ret_code_t iohub_cc1101_tx_stream(cc1101_ctx *aCtx, const u8 *aHeader, u8 aHeaderLen, const u8 *aData, u32 aDataLen, BOOL afInfinite)
+{
+	u8 			theChunk[CC1101_BUFFER_LEN];
+	u32 		theTotal = aHeaderLen + aDataLen;
+	u32 		thePushed = 0;
+	BOOL		theStarted = FALSE;
+	BOOL		theFixed = !afInfinite;
+	u32 		theStartTimeMs = IOHUB_TIMER_START();
+	ret_code_t	theRet = SUCCESS;
+
+	if (aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+	memset(&aCtx->mTxReport, 0x00, sizeof(cc1101_tx_report));
+
+		//In a session the FIFO is empty after the previous packet, the radio stays in RX / FSTXON and STX goes straight to TX
+	if (!aCtx->mfSessionActive)
+	{
+		setIdleState(aCtx);
+		flushTxFifo(aCtx);
+	}
+
+	while (thePushed < theTotal)
+	{
+		u8 theFifoBytes = 0;
+		u8 theRoom;
+
+		if (!theStarted)
+			theRoom = CC1101_BUFFER_LEN;
+		else if (iohub_cc1101_has_tx_threshold(aCtx))
+		{
+			while (iohub_digital_read(aCtx->mGDO2Pin) == PinLevel_High && IOHUB_TIMER_ELAPSED(theStartTimeMs) < CC1101_STREAM_TIMEOUT_MS)
+				iohub_time_delay_us(CC1101_STREAM_POLL_US);
+
+				//Still above threshold: no room, the timeout below gives up
+			theRoom = (iohub_digital_read(aCtx->mGDO2Pin) == PinLevel_High) ? 0 : CC1101_STREAM_TX_CHUNK;
+			theFifoBytes = CC1101_BUFFER_LEN - CC1101_STREAM_TX_CHUNK; //Upper bound, only used for the fixed mode switch
+		}
+		else
+		{
+			theFifoBytes = iohub_cc1101_read_fifo_bytes(aCtx, CC1101_TXBYTES);
+			if (theFifoBytes & 0x80)
+			{
+				LOG_ERROR_CC1101("TX FIFO underflow");
+				theRet = E_WRITE_ERROR;
+				break;
+			}
+
+			theRoom = CC1101_BUFFER_LEN - theFifoBytes;
+		}
+
+		if (!theFixed && (theTotal - (thePushed - theFifoBytes)) < 256)
+		{
+			iohub_cc1101_set_reg(aCtx, CC1101_PKTCTRL0, (aCtx->mRegs[CC1101_PKTCTRL0] & ~CC1101_PKTCTRL0_LENGTH_MASK) | CC1101_PKTCTRL0_LENGTH_FIXED);
+			(void)iohub_cc1101_flush_regs(aCtx);
+			theFixed = TRUE;
+		}
+
+		if (theRoom == 0)
+		{
+			if (IOHUB_TIMER_ELAPSED(theStartTimeMs) >= CC1101_STREAM_TIMEOUT_MS)
+			{
+				theRet = E_TIMEOUT;
+				break;
+			}
+
+			iohub_time_delay_us(CC1101_STREAM_POLL_US);
+			continue;
+		}
+
+		u8 theCount = 0;
+		while (theCount < theRoom && thePushed < theTotal)
+		{
+			theChunk[theCount++] = (thePushed < aHeaderLen) ? aHeader[thePushed] : aData[thePushed - aHeaderLen];
+			thePushed++;
+		}
+
+		theRet = iohub_cc1101_write_burst_reg(aCtx, CC1101_TXFIFO, theChunk, theCount);
+		if (theRet != SUCCESS)
+			break;
+
+		if (!theStarted)
+		{
+				//Armed before STX, the end of packet edge may come before STX returns
+			if (aCtx->mfCCAEnabled)
+			{
+				theRet = iohub_cc1101_cca_start(aCtx, theCount);
+				if (theRet != SUCCESS)
+					break;
+			}
+			else
+			{
+				iohub_cc1101_clear_rx_event(aCtx);
+				setTxState(aCtx);
+			}
+
+			theStarted = TRUE;
+		}
+	}
+
+	aCtx->mTxReport.mfSent = (theRet == SUCCESS) ? TRUE : FALSE;
+	aCtx->mTxReport.mFrameCount = aCtx->mTxReport.mfSent ? 1 : 0;
+
+	if (theRet == SUCCESS)
+		(void)iohub_cc1101_wait_state(aCtx, aCtx->mfSessionActive ? STATE_RX : STATE_IDLE, CC1101_STREAM_TIMEOUT_MS, TRUE);
+	else
+	{
+		setIdleState(aCtx);
+		flushTxFifo(aCtx);
+
+		if (aCtx->mfSessionActive)
+			setRxState(aCtx);
+	}
+
+		//GDO0 also de-asserts at the end of a transmitted packet, that is not a reception
+	iohub_cc1101_clear_rx_event(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Read exactly aLength bytes from the RX FIFO, waiting for them while the packet is still on air
+static ret_code_t iohub_cc1101_rx_read(cc1101_ctx *aCtx, u8 *aBuffer, u16 aLength, u32 aStartTimeMs, u32 aTimeoutMs)
+{
+	while (aLength > 0)
+	{
+		if (iohub_cc1101_has_gdo2(aCtx) && aCtx->mRegs[CC1101_IOCFG2] == CC1101_IOCFG_RX_THR_OR_END)
+		{
+			while (iohub_digital_read(aCtx->mGDO2Pin) == PinLevel_Low && iohub_time_remaining(aStartTimeMs, aTimeoutMs) > 0)
+				iohub_time_delay_us(CC1101_STREAM_POLL_US);
+		}
+
+		u8 theAvailable = iohub_cc1101_read_fifo_bytes(aCtx, CC1101_RXBYTES);
+		if (theAvailable & 0x80)
+		{
+			LOG_ERROR_CC1101("RX FIFO Overflow, drop packets");
+			return E_READ_ERROR;
+		}
+
+			//Errata: never empty the FIFO while more bytes of the packet are expected
+		u16 theCount = (theAvailable >= aLength) ? aLength : (theAvailable > 0 ? theAvailable - 1 : 0);
+
+		if (theCount == 0)
+		{
+			if (iohub_time_remaining(aStartTimeMs, aTimeoutMs) == 0)
+				return E_TIMEOUT;
+
+			iohub_time_delay_us(CC1101_STREAM_POLL_US);
+			continue;
+		}
+
+		ret_code_t theRet = iohub_cc1101_read_burst_reg(aCtx, CC1101_RXFIFO, aBuffer, theCount);
+		if (theRet != SUCCESS)
+			return theRet;
+
+		aBuffer += theCount;
+		aLength -= theCount;
+	}
+
+	return SUCCESS;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Variable length packet: length, destination, payload and, when enabled, appended RSSI / LQI
+static ret_code_t iohub_cc1101_read_packet(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket, u32 aTimeoutMs)
+{
+	u32 		theStartTimeMs = IOHUB_TIMER_START();
+	u8 			theHeader[2];
+	ret_code_t 	theRet;
+
+	theRet = iohub_cc1101_rx_read(aCtx, theHeader, 1, theStartTimeMs, aTimeoutMs);
+	if (theRet != SUCCESS)
+		return theRet;
+
+	if (theHeader[0] == 0)
+		return E_INVALID_DATA;
+
+	theRet = iohub_cc1101_rx_read(aCtx, &theHeader[1], 1, theStartTimeMs, aTimeoutMs);
+	if (theRet != SUCCESS)
+		return theRet;
+
+	LOG_DEBUG_CC1101("Reading data from FIFO (Len: %d)...", theHeader[0]);
+
+	aPacket->mDst = theHeader[1];
+	theRet = iohub_cc1101_rx_read(aCtx, aPacket->mData, theHeader[0] - 1, theStartTimeMs, aTimeoutMs);
+	if (theRet != SUCCESS)
+		return theRet;
+
+	aPacket->mLength = theHeader[0] - 1;
+
+	if (aCtx->mRegs[CC1101_PKTCTRL1] & CC1101_PKTCTRL1_APPEND_STATUS)
+	{
+		u8 theStatus[2] = {0x00};
+
+		theRet = iohub_cc1101_rx_read(aCtx, theStatus, sizeof(theStatus), theStartTimeMs, aTimeoutMs);
+		if (theRet != SUCCESS)
+			return theRet;
+
+		aPacket->mRSSI = theStatus[0];
+		aPacket->mLinkQualityIndex = (theStatus[1] & 0x7F);
+		aPacket->mfCrcOk = (theStatus[1] & 0x80) ? TRUE : FALSE;
+	}
+	else
+	{
+		u8 theValue = iohub_cc1101_read_status_reg(aCtx, CC1101_LQI);
+		aPacket->mLinkQualityIndex = (theValue & 0x7F);
+		aPacket->mfCrcOk = (theValue & 0x80) ? TRUE : FALSE;
+		aPacket->mRSSI = iohub_cc1101_read_status_reg(aCtx, CC1101_RSSI);
+	}
+
+	aCtx->mFilterStats.mDelivered++;
+	if (!aPacket->mfCrcOk && (aCtx->mRegs[CC1101_PKTCTRL0] & CC1101_PKTCTRL0_CRC_EN))
+		aCtx->mFilterStats.mCrcErrors++;
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Longest packet allowed by the configuration does not fit in the FIFO: drain it while on air
+static BOOL iohub_cc1101_rx_needs_streaming(cc1101_ctx *aCtx)
+{
+	u16 theMaxLen = aCtx->mRegs[CC1101_PKTLEN] + 1;
+
+	if (aCtx->mRegs[CC1101_PKTCTRL1] & CC1101_PKTCTRL1_APPEND_STATUS)
+		theMaxLen += 2;
+
+	return (theMaxLen > CC1101_BUFFER_LEN) ? TRUE : FALSE;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_send_data(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket)
+{
+	LOG_DEBUG_CC1101("iohub_cc1101_send %d bytes...", aPacket->mLength);
+
+	if (aPacket->mLength > CC1101_DATA_LEN)
+		return E_INVALID_PARAMETERS;
+
+	u8 theHeader[2] = { (u8)(aPacket->mLength + 1), aPacket->mDst };
+
+	iohub_cc1101_wakeup(aCtx);
+
+	ret_code_t theRet = iohub_cc1101_tx_stream(aCtx, theHeader, sizeof(theHeader), aPacket->mData, aPacket->mLength, FALSE);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+    return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Repeated frames
+	======================
+	The TX FIFO cannot be rewound, a byte sent is gone. The copies are built once and the radio
+	stays on between them, one wakeup / standby and one calibration for the whole burst:
+	- No gap: as many copies as fit go in one FIFO upload, MCSM1.TXOFF_MODE = TX chains them with
+	  only the preamble in between. GDO0 end of packet edges tell when a batch is out.
+	- Gap: TXOFF_MODE = FSTXON keeps the synthesizer locked, each copy is one burst + STX issued
+	  aGapUs after the previous end of packet.
+*/
+
+	//Edges of the aCount packets of a chained batch, the radio never leaves TX on its own
+static ret_code_t iohub_cc1101_repeat_wait(cc1101_ctx *aCtx, u8 aCount, BOOL afChained)
+{
+	u32 theStartTimeMs = IOHUB_TIMER_START();
+
+	if (!afChained)
+		return iohub_cc1101_wait_state(aCtx, STATE_FSTXON, CC1101_STREAM_TIMEOUT_MS, TRUE) ? SUCCESS : E_TIMEOUT;
+
+	while (aCtx->mRxPendingCount < aCount)
+	{
+		if (!iohub_event_wait(&aCtx->mRxEvent, iohub_time_remaining(theStartTimeMs, CC1101_STREAM_TIMEOUT_MS)) &&
+			aCtx->mRxPendingCount < aCount)
+			return E_TIMEOUT;
+	}
+
+	return SUCCESS;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_send_repeat(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket, u8 aCount, u32 aGapUs)
+{
+	u8 			theFrames[CC1101_BUFFER_LEN];
+	u8 			theChunk[CC1101_BUFFER_LEN];
+	u8 			theFrameLen = aPacket->mLength + 2;
+	u8 			theBatch;
+	u8 			theSent = 0;
+	u8 			theSavedMCSM1;
+	BOOL		theChained;
+	uint64_t	theEndUs = 0;
+	ret_code_t 	theRet = SUCCESS;
+
+	if (aCount == 0 || aPacket->mLength > CC1101_BUFFER_LEN - 2)
+		return E_INVALID_PARAMETERS;
+
+	if (aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+	theChained = (aGapUs == 0 && iohub_cc1101_has_gdo0(aCtx) && aCtx->mRegs[CC1101_IOCFG0] == CC1101_IOCFG_SYNC_OR_END) ? TRUE : FALSE;
+	theBatch = theChained ? MIN(aCount, CC1101_BUFFER_LEN / theFrameLen) : 1;
+
+	for (u8 i=0; i<theBatch; i++)
+	{
+		theFrames[i * theFrameLen] = (u8)(aPacket->mLength + 1);
+		theFrames[i * theFrameLen + 1] = aPacket->mDst;
+		memcpy(&theFrames[i * theFrameLen + 2], aPacket->mData, aPacket->mLength);
+	}
+
+	LOG_DEBUG_CC1101("iohub_cc1101_send_repeat %d bytes x %u (%s)...", aPacket->mLength, aCount, theChained ? "chained" : "FSTXON");
+
+	iohub_cc1101_wakeup(aCtx);
+
+	memset(&aCtx->mTxReport, 0x00, sizeof(cc1101_tx_report));
+
+	if (!aCtx->mfSessionActive)
+	{
+		setIdleState(aCtx);
+		flushTxFifo(aCtx);
+	}
+
+	theSavedMCSM1 = aCtx->mRegs[CC1101_MCSM1];
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, (theSavedMCSM1 & ~CC1101_MCSM1_TXOFF_MASK) |
+											 (theChained ? CC1101_MCSM1_TXOFF_TX : CC1101_MCSM1_TXOFF_FSTXON));
+	(void)iohub_cc1101_flush_regs(aCtx);
+
+	while (theSent < aCount && theRet == SUCCESS)
+	{
+		u8 theCount = MIN(theBatch, aCount - theSent);
+
+			//The SPI transfer is done in place, the staged copies must survive it
+		memcpy(theChunk, theFrames, theCount * theFrameLen);
+
+		if (theSent > 0 && theChained)
+		{
+				//Still in TX sending preamble, the next batch goes out as soon as it is loaded
+			iohub_cc1101_clear_rx_event(aCtx);
+			theRet = iohub_cc1101_write_burst_reg(aCtx, CC1101_TXFIFO, theChunk, theCount * theFrameLen);
+		}
+		else
+		{
+			if (theSent > 0)
+			{
+				u32 theElapsedUs = (u32)(iohub_time_now_us() - theEndUs);
+				if (theElapsedUs < aGapUs)
+					iohub_time_delay_us(aGapUs - theElapsedUs);
+			}
+
+			theRet = iohub_cc1101_write_burst_reg(aCtx, CC1101_TXFIFO, theChunk, theCount * theFrameLen);
+			if (theRet != SUCCESS)
+				break;
+
+				//Clear channel assessment once, the channel is then held until the last copy
+			if (theSent == 0 && aCtx->mfCCAEnabled)
+				theRet = iohub_cc1101_cca_start(aCtx, theCount * theFrameLen);
+			else
+			{
+				iohub_cc1101_clear_rx_event(aCtx);
+				setTxState(aCtx);
+			}
+		}
+
+		if (theRet == SUCCESS)
+			theRet = iohub_cc1101_repeat_wait(aCtx, theCount, theChained);
+
+		if (theRet == SUCCESS)
+		{
+			theEndUs = iohub_cc1101_has_gdo0(aCtx) ? aCtx->mRxEventTimeUs : iohub_time_now_us();
+			theSent += theCount;
+		}
+	}
+
+	aCtx->mTxReport.mfSent = (theRet == SUCCESS) ? TRUE : FALSE;
+	aCtx->mTxReport.mFrameCount = theSent;
+
+	setIdleState(aCtx);
+	if (theRet != SUCCESS)
+		flushTxFifo(aCtx);
+
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, theSavedMCSM1);
+	(void)iohub_cc1101_flush_regs(aCtx);
+
+	if (aCtx->mfSessionActive)
+		setRxState(aCtx);
+
+		//End of packet edges of our own frames
+	iohub_cc1101_clear_rx_event(aCtx);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_send_long(cc1101_ctx *aCtx, const u8 *aData, u16 aLength)
+{
+	u8 			theSavedRegs[4];
+	u32 		theTotal = CC1101_INFINITE_HEADER_LEN + aLength;
+	u8 			theHeader[CC1101_INFINITE_HEADER_LEN] = { (u8)(aLength >> 8), (u8)(aLength & 0xFF) };
+	ret_code_t 	theRet;
+
+	LOG_DEBUG_CC1101("iohub_cc1101_send_long %u bytes...", aLength);
+
+	iohub_cc1101_wakeup(aCtx);
+
+	iohub_cc1101_stream_save(aCtx, theSavedRegs);
+	iohub_cc1101_stream_begin(aCtx, CC1101_IOCFG_TX_THR,
+							(theSavedRegs[2] & ~CC1101_PKTCTRL0_LENGTH_MASK) | CC1101_PKTCTRL0_LENGTH_INFINITE,
+							(u8)(theTotal & 0xFF));
+
+	theRet = iohub_cc1101_tx_stream(aCtx, theHeader, sizeof(theHeader), aData, aLength, TRUE);
+
+	iohub_cc1101_stream_end(aCtx, theSavedRegs);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_receive_long(cc1101_ctx *aCtx, u8 *aBuffer, u16 aBufferLen, u16 *aLength, u32 aTimeoutMs)
+{
+	u8 			theSavedRegs[4];
+	u8 			theHeader[CC1101_INFINITE_HEADER_LEN];
+	u32 		theStartTimeMs = IOHUB_TIMER_START();
+	ret_code_t 	theRet;
+
+	*aLength = 0;
+
+	if (aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+	iohub_cc1101_wakeup(aCtx);
+
+		//Radio must already be in infinite mode when the sync word comes in
+	iohub_cc1101_stream_save(aCtx, theSavedRegs);
+	iohub_cc1101_stream_begin(aCtx, CC1101_IOCFG_RX_THR_OR_END,
+							(theSavedRegs[2] & ~CC1101_PKTCTRL0_LENGTH_MASK) | CC1101_PKTCTRL0_LENGTH_INFINITE,
+							theSavedRegs[3]);
+	iohub_cc1101_set_receive(aCtx);
+
+	theRet = iohub_cc1101_rx_read(aCtx, theHeader, sizeof(theHeader), theStartTimeMs, aTimeoutMs);
+	if (theRet == SUCCESS)
+	{
+		u16 theLength = ((u16)theHeader[0] << 8) | theHeader[1];
+		u32 theTotal = CC1101_INFINITE_HEADER_LEN + theLength;
+		u32 theRead = CC1101_INFINITE_HEADER_LEN;
+
+		iohub_cc1101_set_reg(aCtx, CC1101_PKTLEN, (u8)(theTotal & 0xFF));
+		(void)iohub_cc1101_flush_regs(aCtx);
+
+		if (theLength > aBufferLen)
+			theRet = E_INVALID_PARAMETERS;
+
+		while (theRet == SUCCESS && theRead < theTotal)
+		{
+				//Chunks of at most half the FIFO so the fixed length switch happens in time
+			u16 theCount = MIN(theTotal - theRead, CC1101_BUFFER_LEN / 2);
+
+			if (theTotal - theRead < 256 && (aCtx->mRegs[CC1101_PKTCTRL0] & CC1101_PKTCTRL0_LENGTH_MASK) != CC1101_PKTCTRL0_LENGTH_FIXED)
+			{
+				iohub_cc1101_set_reg(aCtx, CC1101_PKTCTRL0, (aCtx->mRegs[CC1101_PKTCTRL0] & ~CC1101_PKTCTRL0_LENGTH_MASK) | CC1101_PKTCTRL0_LENGTH_FIXED);
+				(void)iohub_cc1101_flush_regs(aCtx);
+			}
+
+			theRet = iohub_cc1101_rx_read(aCtx, &aBuffer[theRead - CC1101_INFINITE_HEADER_LEN], theCount, theStartTimeMs, aTimeoutMs);
+			theRead += theCount;
+		}
+
+		if (theRet == SUCCESS)
+			*aLength = theLength;
+	}
+
+	iohub_cc1101_stream_end(aCtx, theSavedRegs);
+	iohub_cc1101_set_receive(aCtx);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_set_gdo2_pin(cc1101_ctx *aCtx, u32 aGDO2Pin)
+{
+	aCtx->mGDO2Pin = aGDO2Pin;
+
+	if (iohub_cc1101_has_gdo2(aCtx))
+		iohub_digital_set_pin_mode(aCtx->mGDO2Pin, PinMode_Input);
+}
+
+/* -------------------------------------------------------------- */
+
+BOOL iohub_cc1101_is_data_available(cc1101_ctx *aCtx)
+{
+	IOHUB_ASSERT(aCtx->mWakeupCount > 0);
+
+	if (iohub_cc1101_has_gdo0(aCtx)) //No SPI traffic, the end of packet interrupt tells us
+		return (aCtx->mRxPendingCount > 0) ? TRUE : FALSE;
+
+		//One SNOP gives both the state and the RX FIFO level, RXBYTES / MARCSTATE are not needed
+	iohub_cc1101_refresh_status(aCtx);
+
+	switch (CC1101_STATUS_STATE(aCtx->mStatus))
+	{
+		case 0x06: //RXFIFO_OVERFLOW
+			return TRUE;
+
+		case 0x00: //Device will automatically enter in IDLE state when it will fully receive a message
+			return (aCtx->mRxFifoBytes > 0) ? TRUE : FALSE;
+
+		default:
+			return FALSE;
 	}
-	
-	return FALSE;
 	
 	/*
 	if ( iohub_digital_read(aCtx->mGDO0Pin) == PinLevel_High )
 	{
-		LOG_DEBUG_CC1101(".");
-		//if(iohub_cc1101_read_config_reg(aCtx, CC1101_IOCFG0) == 0x06)
-        {
-            while(iohub_digital_read(aCtx->mGDO0Pin) == PinLevel_High)
-                LOG_DEBUG_CC1101("!");
-        }
+		LOG_DEBUG_CC1101(".");
+		//if(iohub_cc1101_read_config_reg(aCtx, CC1101_IOCFG0) == 0x06)
+        {
+            while(iohub_digital_read(aCtx->mGDO0Pin) == PinLevel_High)
+                LOG_DEBUG_CC1101("!");
+        }
+
+		return TRUE;
+	}
+	
+	return FALSE;
+	*/
+}
+
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_set_receive(cc1101_ctx *aCtx)
+{
+	LOG_DEBUG_CC1101("Enter in RX state !");
+	
+	IOHUB_ASSERT(aCtx->mWakeupCount > 0);
+
+	if (aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+	
+	setIdleState(aCtx);
+	flushRxFifo(aCtx);
+	iohub_cc1101_clear_rx_event(aCtx);
+
+	if (aCtx->mfWorActive)
+		return iohub_cc1101_strobe(aCtx, CC1101_SWOR);
+		
+	setRxState(aCtx);
+	
+	(void)iohub_cc1101_wait_for_state(aCtx, STATE_RX, 1000);
+	
+	return SUCCESS;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Back to RX after the FIFO has been read, only strobing what the current state requires
+static void iohub_cc1101_rx_resume(cc1101_ctx *aCtx)
+{
+	if (aCtx->mfWorActive)
+	{
+		setIdleState(aCtx);
+		(void)iohub_cc1101_strobe(aCtx, CC1101_SWOR);
+		return;
+	}
+
+	iohub_cc1101_refresh_status(aCtx);
+
+	switch (iohub_cc1101_get_state(aCtx))
+	{
+		case STATE_RX:
+			break;
+
+		case STATE_IDLE:
+			setRxState(aCtx); //FIFO already drained, no flush needed
+			break;
+
+		default:
+			iohub_cc1101_set_receive(aCtx);
+			break;
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_receive_data(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket)
+{
+	ret_code_t theErr = SUCCESS;
+	
+    aPacket->mLength = 0;
+
+	if (aCtx->mRxRing != NULL)
+	{
+		theErr = iohub_cc1101_rx_drain(aCtx);
+		(void)iohub_cc1101_dequeue(aCtx, aPacket);
+
+		return theErr;
+	}
+	
+	iohub_cc1101_wakeup(aCtx);
+
+	u8 thePendingCount = aCtx->mRxPendingCount;
+	aCtx->mRxPendingCount = 0; //Anything arriving from now on is read below or flagged again
+	
+	u8 theValue = iohub_cc1101_read_status_reg(aCtx, CC1101_RXBYTES);
+	if (theValue & 0x80) //RX fifo overflow
+	{
+		LOG_ERROR_CC1101("RX FIFO Overflow, drop packets");
+		
+		iohub_cc1101_set_receive(aCtx); //Re-enter in RX State
+		
+		theErr = E_READ_ERROR;
+	}
+	else if (theValue > 0)
+	{
+		aPacket->mTimeUs = (thePendingCount == 1) ? aCtx->mRxEventTimeUs : iohub_time_now_us();
+
+		theErr = iohub_cc1101_read_packet(aCtx, aPacket, CC1101_STREAM_TIMEOUT_MS);
+		if (theErr != SUCCESS)
+		{
+			aPacket->mLength = 0;
+			iohub_cc1101_set_receive(aCtx); //Partial packet left in the FIFO
+		}
+		else
+		{
+				//Other edges: more packets in the FIFO or dropped ones, told apart on the next call
+			if (thePendingCount > 1)
+				aCtx->mRxPendingCount += thePendingCount - 1;
+
+			iohub_cc1101_rx_resume(aCtx);
+		}
+	}
+	else
+	{
+		LOG_DEBUG_CC1101("No data pending");
+
+			//End of packet without data: filtered out by the chip
+		aCtx->mFilterStats.mDropped += thePendingCount;
+	}
+	
+    (void)iohub_cc1101_standby(aCtx);
+	
+	return theErr;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_set_rx_ring(cc1101_ctx *aCtx, cc1101_packet_ctx *aBuffer, u8 aSize)
+{
+	if (aBuffer != NULL && aSize == 0)
+		return E_INVALID_PARAMETERS;
+
+	if (aBuffer != NULL && aCtx->mRxRing == NULL)
+	{
+			//Stay in RX after a packet so the next one is not missed while the host reads the FIFO
+		aCtx->mRxRingSavedMCSM1 = aCtx->mRegs[CC1101_MCSM1];
+		iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, (aCtx->mRegs[CC1101_MCSM1] & ~CC1101_MCSM1_RXOFF_MASK) | CC1101_MCSM1_RXOFF_RX);
+	}
+	else if (aBuffer == NULL && aCtx->mRxRing != NULL)
+		iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, aCtx->mRxRingSavedMCSM1);
+
+	aCtx->mRxRing = aBuffer;
+	aCtx->mRxRingSize = (aBuffer != NULL) ? aSize : 0;
+	aCtx->mRxRingHead = 0;
+	aCtx->mRxRingCount = 0;
+	aCtx->mRxRingDropped = 0;
+
+	return iohub_cc1101_flush_regs(aCtx);
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_rx_drain(cc1101_ctx *aCtx)
+{
+	cc1101_packet_ctx 	theDropped;
+	ret_code_t 			theErr = SUCCESS;
+
+	if (aCtx->mRxRing == NULL)
+		return E_INVALID_STATE;
+
+	iohub_cc1101_wakeup(aCtx);
+
+	u8 thePendingCount = aCtx->mRxPendingCount;
+	u8 theEdgeCount = thePendingCount;
+	u8 theReadCount = 0;
+	aCtx->mRxPendingCount = 0;
+
+	for (;;)
+	{
+		u8 theValue = iohub_cc1101_read_fifo_bytes(aCtx, CC1101_RXBYTES);
+
+		if (theValue & 0x80)
+		{
+			LOG_ERROR_CC1101("RX FIFO Overflow, drop packets");
+			aCtx->mRxRingDropped++;
+			iohub_cc1101_set_receive(aCtx);
+
+			theErr = E_READ_ERROR;
+			break;
+		}
+
+		if (theValue == 0)
+		{
+				//More edges than packets: the others were filtered out by the chip
+			if (theEdgeCount > theReadCount)
+				aCtx->mFilterStats.mDropped += theEdgeCount - theReadCount;
+
+			iohub_cc1101_rx_resume(aCtx);
+			break;
+		}
+
+		cc1101_packet_ctx *thePacket;
+		BOOL theFull = (aCtx->mRxRingCount >= aCtx->mRxRingSize) ? TRUE : FALSE;
+
+		if (theFull)
+			thePacket = &theDropped; //Still read it, the FIFO must be emptied
+		else
+			thePacket = &aCtx->mRxRing[(aCtx->mRxRingHead + aCtx->mRxRingCount) % aCtx->mRxRingSize];
+
+			//Only a single end of packet edge can be matched with a single packet
+		thePacket->mTimeUs = (thePendingCount == 1) ? aCtx->mRxEventTimeUs : iohub_time_now_us();
+		thePendingCount = 0;
+
+		theErr = iohub_cc1101_read_packet(aCtx, thePacket, CC1101_STREAM_TIMEOUT_MS);
+		if (theErr != SUCCESS)
+		{
+			iohub_cc1101_set_receive(aCtx);
+			break;
+		}
+
+		theReadCount++;
+
+		if (theFull)
+			aCtx->mRxRingDropped++;
+		else
+			aCtx->mRxRingCount++;
+	}
+
+    (void)iohub_cc1101_standby(aCtx);
+
+	return theErr;
+}
+
+/* -------------------------------------------------------------- */
+
+BOOL iohub_cc1101_dequeue(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket)
+{
+	if (aCtx->mRxRingCount == 0)
+		return FALSE;
+
+	memcpy(aPacket, &aCtx->mRxRing[aCtx->mRxRingHead], sizeof(cc1101_packet_ctx));
+
+	aCtx->mRxRingHead = (aCtx->mRxRingHead + 1) % aCtx->mRxRingSize;
+	aCtx->mRxRingCount--;
+
+	return TRUE;
+}
+
+/* -------------------------------------------------------------- */
+
+u8 iohub_cc1101_rx_count(cc1101_ctx *aCtx)
+{
+	return aCtx->mRxRingCount;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_receive_data_timeout(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket, u32 aTimeoutMs)
+{
+	u32 		theStartTimeMs = IOHUB_TIMER_START();
+	ret_code_t 	theRet;
+
+	IOHUB_ASSERT(aCtx->mWakeupCount > 0); //Radio must stay in RX while waiting
+
+    aPacket->mLength = 0;
+
+	for (;;)
+	{
+		u32 theRemainingMs = iohub_time_remaining(theStartTimeMs, aTimeoutMs);
+
+		if (aCtx->mRxRing != NULL && iohub_cc1101_dequeue(aCtx, aPacket))
+			return SUCCESS;
+
+		if (iohub_cc1101_rx_needs_streaming(aCtx))
+		{
+				//End of packet comes too late, start draining as soon as bytes come in
+			while (!(iohub_cc1101_has_gdo0(aCtx) && iohub_digital_read(aCtx->mGDO0Pin) == PinLevel_High) &&
+				   (iohub_cc1101_read_status_reg(aCtx, CC1101_RXBYTES) == 0))
+			{
+				if (iohub_time_remaining(theStartTimeMs, aTimeoutMs) == 0)
+					return E_TIMEOUT;
+
+				iohub_time_delay_us(CC1101_STREAM_POLL_US);
+			}
+		}
+		else if (iohub_cc1101_has_gdo0(aCtx))
+		{
+			if (aCtx->mRxPendingCount == 0 && !iohub_event_wait(&aCtx->mRxEvent, theRemainingMs))
+				return E_TIMEOUT;
+		}
+		else
+		{
+			while (!iohub_cc1101_is_data_available(aCtx))
+			{
+				if (iohub_time_remaining(theStartTimeMs, aTimeoutMs) == 0)
+					return E_TIMEOUT;
+
+				iohub_time_delay_ms(1);
+			}
+		}
+
+		theRet = iohub_cc1101_receive_data(aCtx, aPacket);
+		if (theRet != SUCCESS || aPacket->mLength > 0)
+			return theRet;
+
+			//Packet discarded by the radio (filtering, overflow), keep waiting
+		if (iohub_time_remaining(theStartTimeMs, aTimeoutMs) == 0)
+			return E_TIMEOUT;
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_set_rx_callback(cc1101_ctx *aCtx, cc1101_rx_callback aCallback, void *anArg)
+{
+	aCtx->mRxCallback = aCallback;
+	aCtx->mRxCallbackArg = anArg;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_process(cc1101_ctx *aCtx)
+{
+	cc1101_packet_ctx 	thePacket;
+	ret_code_t 			theRet;
+
+	if (aCtx->mAsyncReceiver != NULL)
+		return SUCCESS;
+
+	if (aCtx->mRxRing != NULL)
+	{
+		theRet = (aCtx->mRxPendingCount > 0) ? iohub_cc1101_rx_drain(aCtx) : SUCCESS;
+
+		while (aCtx->mRxCallback != NULL && iohub_cc1101_dequeue(aCtx, &thePacket))
+			aCtx->mRxCallback(aCtx, &thePacket, aCtx->mRxCallbackArg);
+
+		return theRet;
+	}
+
+	if (aCtx->mRxPendingCount == 0)
+		return SUCCESS;
+
+	theRet = iohub_cc1101_receive_data(aCtx, &thePacket);
+	if (theRet == SUCCESS && thePacket.mLength > 0 && aCtx->mRxCallback != NULL)
+		aCtx->mRxCallback(aCtx, &thePacket, aCtx->mRxCallbackArg);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Wake-on-Radio
+	======================
+	Event0 period = 750 / XOSC * EVENT0 * 2^(5 * WOR_RES). The listen window is a fraction of it that
+	depends on WOR_RES too (datasheet RX_TIME table): 12.5% / 2^RX_TIME with WOR_RES = 0, then
+	1.95% / 2^RX_TIME with WOR_RES = 1, divided again by 32 for every further WOR_RES step.
+	A packet wakes the host through GDO0, the radio then waits in IDLE (or RX) until the FIFO is read
+	and the driver strobes SWOR again.
+*/
+
+	//Data rate from MDMCFG4.DRATE_E / MDMCFG3.DRATE_M
+static u32 iohub_cc1101_get_data_rate(cc1101_ctx *aCtx)
+{
+	u8 theExponent = aCtx->mRegs[CC1101_MDMCFG4] & 0x0F;
+	uint64_t theRate = (256ULL + aCtx->mRegs[CC1101_MDMCFG3]) << theExponent;
+
+	return (u32)((theRate * CC1101_XOSC_HZ) >> 28);
+}
+
+/* -------------------------------------------------------------- */
+
+	//Listen window = period * aNum / 2^aShift for a WOR_RES / RX_TIME pair
+static void iohub_cc1101_wor_window(u8 aWorRes, u8 aRxTime, u8 *aNum, u8 *aShift)
+{
+	*aNum = (aWorRes == 0) ? 1 : 5;
+	*aShift = aRxTime + 3 + 5 * aWorRes;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_wor_compute(cc1101_ctx *aCtx, u32 aDutyCyclePpm, u16 aPreambleBytes, cc1101_wor_settings *aSettings)
+{
+	u32 theDataRate = iohub_cc1101_get_data_rate(aCtx);
+
+	memset(aSettings, 0x00, sizeof(cc1101_wor_settings));
+
+	if (theDataRate == 0 || aPreambleBytes == 0)
+		return E_INVALID_PARAMETERS;
+
+	uint64_t thePreambleUs = ((uint64_t)aPreambleBytes * 8 * 1000000) / theDataRate;
+
+		//Smallest resolution that can encode the interval, the available duty cycles depend on it
+	u8 			theWorRes;
+	u8 			theRxTime = 0;
+	u8 			theNum = 1;
+	u8 			theShift = 3;
+	uint64_t 	theEvent0 = 0;
+	for (theWorRes=0; theWorRes<4; theWorRes++)
+	{
+			//Highest duty cycle below the requested one, the lowest available otherwise (RX_TIME 7 is no timeout)
+		for (theRxTime=0; theRxTime<6; theRxTime++)
+		{
+			iohub_cc1101_wor_window(theWorRes, theRxTime, &theNum, &theShift);
+			if (1000000ULL * theNum <= ((uint64_t)aDutyCyclePpm << theShift))
+				break;
+		}
+		iohub_cc1101_wor_window(theWorRes, theRxTime, &theNum, &theShift);
+
+		uint64_t theIntervalUs = (thePreambleUs << theShift) / ((1ULL << theShift) + theNum); //Interval + window fits in the preamble
+
+		theEvent0 = (theIntervalUs * CC1101_XOSC_HZ) / (750ULL * 1000000 << (5 * theWorRes));
+		if (theEvent0 <= 0xFFFF)
+			break;
+	}
+
+	if (theWorRes == 4 || theEvent0 == 0)
+		return E_INVALID_PARAMETERS;
+
+	aSettings->mEvent0 = (u16)theEvent0;
+	aSettings->mWorRes = theWorRes;
+	aSettings->mRxTime = theRxTime;
+	aSettings->mIntervalUs = (u32)(((theEvent0 * 750ULL * 1000000) << (5 * theWorRes)) / CC1101_XOSC_HZ);
+	aSettings->mRxTimeoutUs = (u32)(((uint64_t)aSettings->mIntervalUs * theNum) >> theShift);
+	aSettings->mDutyCyclePpm = (u32)((1000000ULL * theNum) >> theShift);
+
+	if ((uint64_t)aSettings->mRxTimeoutUs * theDataRate < (uint64_t)CC1101_WOR_MIN_RX_BYTES * 8 * 1000000)
+	{
+		LOG_ERROR_CC1101("WOR: %lu us listen window too short to catch the preamble", aSettings->mRxTimeoutUs);
+		return E_INVALID_PARAMETERS;
+	}
+
+		//Charge per wake up (nA.us = fC) spread over the interval, calibration every 4th wake up
+	uint64_t theChargePerWake = (uint64_t)aSettings->mRxTimeoutUs * CC1101_WOR_RX_CURRENT_UA * 1000 +
+								(uint64_t)CC1101_WOR_STARTUP_US * CC1101_WOR_STARTUP_CURRENT_UA * 1000 +
+								(uint64_t)CC1101_WOR_CAL_US * CC1101_WOR_CAL_CURRENT_UA * 1000 / 4;
+
+	aSettings->mAverageCurrentNa = (u32)(theChargePerWake / aSettings->mIntervalUs) + CC1101_WOR_SLEEP_CURRENT_NA;
+
+	LOG_DEBUG_CC1101("WOR: interval %lu us, window %lu us, ~%lu nA", aSettings->mIntervalUs, aSettings->mRxTimeoutUs, aSettings->mAverageCurrentNa);
+
+	return SUCCESS;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_wor_start(cc1101_ctx *aCtx, const cc1101_wor_settings *aSettings)
+{
+	ret_code_t theRet;
+
+	if (!iohub_cc1101_has_gdo0(aCtx))
+		return E_NOT_SUPPORTED;
+
+	if (aCtx->mfWorActive || aCtx->mfSessionActive || aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+		//Held until wor_stop(): standby() would power the radio down
+	iohub_cc1101_wakeup(aCtx);
+	setIdleState(aCtx);
+
+	aCtx->mWorSavedRegs[0] = aCtx->mRegs[CC1101_MCSM2];
+	aCtx->mWorSavedRegs[1] = aCtx->mRegs[CC1101_MCSM0];
+	aCtx->mWorSavedRegs[2] = aCtx->mRegs[CC1101_WOREVT1];
+	aCtx->mWorSavedRegs[3] = aCtx->mRegs[CC1101_WOREVT0];
+	aCtx->mWorSavedRegs[4] = aCtx->mRegs[CC1101_WORCTRL];
+
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM2, CC1101_MCSM2_RX_TIME_QUAL | aSettings->mRxTime);
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, (aCtx->mRegs[CC1101_MCSM0] & ~CC1101_MCSM0_FS_AUTOCAL_MASK) | CC1101_MCSM0_FS_AUTOCAL_4TH);
+	iohub_cc1101_set_reg(aCtx, CC1101_WOREVT1, (u8)(aSettings->mEvent0 >> 8));
+	iohub_cc1101_set_reg(aCtx, CC1101_WOREVT0, (u8)(aSettings->mEvent0 & 0xFF));
+	iohub_cc1101_set_reg(aCtx, CC1101_WORCTRL, CC1101_WORCTRL_EVENT1_RC_CAL | (aSettings->mWorRes & 0x03));
+
+	theRet = iohub_cc1101_flush_regs(aCtx);
+	if (theRet != SUCCESS)
+	{
+		(void)iohub_cc1101_standby(aCtx);
+		return theRet;
+	}
+
+	flushRxFifo(aCtx);
+	iohub_cc1101_clear_rx_event(aCtx);
+
+	aCtx->mfWorActive = TRUE;
+
+	(void)iohub_cc1101_strobe(aCtx, CC1101_SWORRST);
+	return iohub_cc1101_strobe(aCtx, CC1101_SWOR);
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_wor_stop(cc1101_ctx *aCtx)
+{
+	if (!aCtx->mfWorActive)
+		return E_INVALID_STATE;
+
+	setIdleState(aCtx);
+	aCtx->mfWorActive = FALSE;
+
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM2, aCtx->mWorSavedRegs[0]);
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, aCtx->mWorSavedRegs[1]);
+	iohub_cc1101_set_reg(aCtx, CC1101_WOREVT1, aCtx->mWorSavedRegs[2]);
+	iohub_cc1101_set_reg(aCtx, CC1101_WOREVT0, aCtx->mWorSavedRegs[3]);
+	iohub_cc1101_set_reg(aCtx, CC1101_WORCTRL, aCtx->mWorSavedRegs[4]);
+
+	ret_code_t theRet = iohub_cc1101_flush_regs(aCtx);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Frequency synthesizer calibration cache
+	======================
+	FSCAL3/2/1 move with the channel, a calibration takes ~720 us. Results are kept per channel
+	(and base frequency, for profiles) and written back in burst mode, the shadow follows so flush_regs() stays consistent.
+*/
+
+static inline u32 iohub_cc1101_fscal_freq(cc1101_ctx *aCtx)
+{
+	return ((u32)aCtx->mRegs[CC1101_FREQ2] << 16) | ((u32)aCtx->mRegs[CC1101_FREQ1] << 8) | aCtx->mRegs[CC1101_FREQ0];
+}
+
+/* -------------------------------------------------------------- */
+
+	//Consecutive channels of one frequency get consecutive slots, other profiles are shifted
+static inline cc1101_fscal_entry *iohub_cc1101_fscal_slot(cc1101_ctx *aCtx)
+{
+	u32 theFreq = iohub_cc1101_fscal_freq(aCtx);
+
+	return &aCtx->mFscalCache[(aCtx->mRegs[CC1101_CHANNR] + (theFreq ^ (theFreq >> 8) ^ (theFreq >> 16))) % CC1101_FSCAL_CACHE_SIZE];
+}
+/* -------------------------------------------------------------- */
+
+static ret_code_t iohub_cc1101_fscal_write(cc1101_ctx *aCtx, const u8 aFscal[3])
+{
+	u8 theBuffer[3];
+
+	memcpy(theBuffer, aFscal, sizeof(theBuffer));
+	memcpy(&aCtx->mRegs[CC1101_FSCAL3], aFscal, sizeof(theBuffer));
+	aCtx->mDirtyRegs &= ~(7ULL << CC1101_FSCAL3);
+
+	return iohub_cc1101_write_burst_reg(aCtx, CC1101_FSCAL3, theBuffer, sizeof(theBuffer));
+}
+
+/* -------------------------------------------------------------- */
+
+	//Calibrate the current channel from IDLE and remember the result
+static ret_code_t iohub_cc1101_fscal_calibrate(cc1101_ctx *aCtx)
+{
+	cc1101_fscal_entry *theEntry = iohub_cc1101_fscal_slot(aCtx);
+
+	setIdleState(aCtx);
+	(void)iohub_cc1101_strobe(aCtx, CC1101_SCAL);
+
+	if (!iohub_cc1101_wait_for_state(aCtx, STATE_IDLE, 2))
+		return E_TIMEOUT;
+
+	ret_code_t theRet = iohub_cc1101_read_burst_reg(aCtx, CC1101_FSCAL3, theEntry->mFscal, sizeof(theEntry->mFscal));
+	if (theRet != SUCCESS)
+		return theRet;
+
+	memcpy(&aCtx->mRegs[CC1101_FSCAL3], theEntry->mFscal, sizeof(theEntry->mFscal));
+	theEntry->mChannel = aCtx->mRegs[CC1101_CHANNR];
+	theEntry->mFreq = iohub_cc1101_fscal_freq(aCtx);
+	theEntry->mTempBucket = aCtx->mFscalTempBucket;
+	theEntry->mfValid = TRUE;
+
+	return SUCCESS;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Entry matching the current frequency / channel / temperature, NULL when not calibrated yet
+static cc1101_fscal_entry *iohub_cc1101_fscal_lookup(cc1101_ctx *aCtx)
+{
+	cc1101_fscal_entry *theEntry = iohub_cc1101_fscal_slot(aCtx);
+
+	if (theEntry->mfValid && theEntry->mChannel == aCtx->mRegs[CC1101_CHANNR] &&
+		theEntry->mFreq == iohub_cc1101_fscal_freq(aCtx) && theEntry->mTempBucket == aCtx->mFscalTempBucket)
+		return theEntry;
+
+	return NULL;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Cached values for the current channel when available, calibration otherwise. Radio must be IDLE
+static ret_code_t iohub_cc1101_fscal_restore(cc1101_ctx *aCtx)
+{
+	cc1101_fscal_entry *theEntry = iohub_cc1101_fscal_lookup(aCtx);
+
+	if (theEntry != NULL)
+		return iohub_cc1101_fscal_write(aCtx, theEntry->mFscal);
+
+	return iohub_cc1101_fscal_calibrate(aCtx);
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_set_fscal_cache(cc1101_ctx *aCtx, BOOL afEnable)
+{
+	if (aCtx->mfFscalCacheEnabled == afEnable)
+		return SUCCESS;
+
+	if (afEnable)
+	{
+		aCtx->mFscalSavedMCSM0 = aCtx->mRegs[CC1101_MCSM0];
+		iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, (aCtx->mRegs[CC1101_MCSM0] & ~CC1101_MCSM0_FS_AUTOCAL_MASK) | CC1101_MCSM0_FS_AUTOCAL_NEVER);
+	}
+	else
+		iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, aCtx->mFscalSavedMCSM0);
+
+	aCtx->mfFscalCacheEnabled = afEnable;
+
+	ret_code_t theRet = iohub_cc1101_flush_regs(aCtx);
+	if (theRet != SUCCESS || !afEnable)
+		return theRet;
+
+		//Autocal is off from now on, the current channel must hold valid values
+	iohub_cc1101_wakeup(aCtx);
+	setIdleState(aCtx);
+	theRet = iohub_cc1101_fscal_restore(aCtx);
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_calibrate_channels(cc1101_ctx *aCtx, const u8 *aChannels, u8 aCount)
+{
+	u8 			theSavedChannel = aCtx->mRegs[CC1101_CHANNR];
+	ret_code_t 	theRet = SUCCESS;
+
+	if (aCtx->mfSessionActive || aCtx->mfWorActive)
+		return E_INVALID_STATE;
+
+	iohub_cc1101_wakeup(aCtx);
+
+	for (u8 i=0; i<aCount && theRet == SUCCESS; i++)
+	{
+		setIdleState(aCtx);
+
+		iohub_cc1101_set_reg(aCtx, CC1101_CHANNR, aChannels[i]);
+		theRet = iohub_cc1101_flush_regs(aCtx);
+		if (theRet == SUCCESS)
+			theRet = iohub_cc1101_fscal_calibrate(aCtx);
+	}
+
+	setIdleState(aCtx);
+	iohub_cc1101_set_reg(aCtx, CC1101_CHANNR, theSavedChannel);
+	if (iohub_cc1101_flush_regs(aCtx) == SUCCESS)
+		(void)iohub_cc1101_fscal_restore(aCtx);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_set_temperature(cc1101_ctx *aCtx, s8 aTemperatureC)
+{
+		//Floor division, -1 C and +1 C are in different buckets
+	s16 theTemperature = aTemperatureC;
+
+	if (theTemperature < 0)
+		theTemperature -= CC1101_FSCAL_TEMP_BUCKET_C - 1;
+
+	aCtx->mFscalTempBucket = (s8)(theTemperature / CC1101_FSCAL_TEMP_BUCKET_C);
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_invalidate_fscal(cc1101_ctx *aCtx)
+{
+	for (u8 i=0; i<CC1101_FSCAL_CACHE_SIZE; i++)
+		aCtx->mFscalCache[i].mfValid = FALSE;
+
+#if CC1101_SCAN_FSCAL_CHANNELS > 0
+	memset(aCtx->mScanFscal.mValid, 0x00, sizeof(aCtx->mScanFscal.mValid));
+#endif
+}
+
+/* -------------------------------------------------------------- */
+
+/*
+	Radio profiles
+	======================
+	A profile is the list of register ranges where it differs from its base table. Switching goes
+	through the shadow: registers of the previous profile go back to the base, the new ranges are
+	applied, and flush_regs() only sends what actually changed.
+*/
+
+ret_code_t iohub_cc1101_profile_compile(cc1101_profile *aProfile, const char *aName, const u8 aBase[CC1101_REGISTERS_COUNT], const u8 aTarget[CC1101_REGISTERS_COUNT])
+{
+	u8 theStart = 0;
+
+	memset(aProfile, 0x00, sizeof(cc1101_profile));
+	aProfile->mName = aName;
+	aProfile->mBase = aBase;
+
+	while (theStart < CC1101_REGISTERS_COUNT)
+	{
+		if (aTarget[theStart] == 0xFF || aTarget[theStart] == aBase[theStart])
+		{
+			theStart++;
+			continue;
+		}
+
+			//Same merge rule as flush_regs(), a short run of equal registers costs less than a new range
+		u8 theEnd = theStart + 1;
+		for (u8 i=theEnd; i<CC1101_REGISTERS_COUNT && i<=theEnd + CC1101_FLUSH_MERGE_GAP; i++)
+		{
+			if (aTarget[i] != 0xFF && aTarget[i] != aBase[i])
+				theEnd = i + 1;
+		}
+
+		if (aProfile->mBlobLen + 2 + (theEnd - theStart) > CC1101_PROFILE_BLOB_MAX)
+			return E_INVALID_PARAMETERS;
+
+		aProfile->mBlob[aProfile->mBlobLen++] = theStart;
+		aProfile->mBlob[aProfile->mBlobLen++] = theEnd - theStart;
+
+		for (u8 i=theStart; i<theEnd; i++)
+			aProfile->mBlob[aProfile->mBlobLen++] = (aTarget[i] == 0xFF) ? aBase[i] : aTarget[i];
+
+		theStart = theEnd;
+	}
+
+	LOG_DEBUG_CC1101("Profile %s: %u bytes blob", aName, aProfile->mBlobLen);
+
+	return SUCCESS;
+}
+
+/* -------------------------------------------------------------- */
+
+	//aUseBase: registers of the ranges go back to the base values instead of the profile ones
+static void iohub_cc1101_profile_stage(cc1101_ctx *aCtx, const cc1101_profile *aProfile, BOOL aUseBase)
+{
+	u8 thePos = 0;
+
+	while (thePos + 2 <= aProfile->mBlobLen)
+	{
+		u8 theStart = aProfile->mBlob[thePos];
+		u8 theCount = aProfile->mBlob[thePos + 1];
+
+		for (u8 i=0; i<theCount; i++)
+		{
+			u8 theReg = theStart + i;
+			u8 theValue = aUseBase ? aProfile->mBase[theReg] : aProfile->mBlob[thePos + 2 + i];
+
+			if (theValue != 0xFF)
+				iohub_cc1101_set_reg(aCtx, theReg, theValue);
+		}
+
+		thePos += 2 + theCount;
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_apply_profile(cc1101_ctx *aCtx, const cc1101_profile *aProfile)
+{
+	ret_code_t theRet;
+
+	if (aCtx->mfWorActive || aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+	if (aCtx->mProfile == aProfile)
+		return SUCCESS;
+
+	if (aCtx->mProfile != NULL && aCtx->mProfile->mBase == aProfile->mBase)
+		iohub_cc1101_profile_stage(aCtx, aCtx->mProfile, TRUE);
+	else
+	{
+			//Unknown starting point: the whole base, the shadow filters what is already there
+		for (u8 i=0; i<CC1101_REGISTERS_COUNT; i++)
+		{
+			if (aProfile->mBase[i] != 0xFF && !CC1101_IS_VOLATILE_REG(i))
+				iohub_cc1101_set_reg(aCtx, i, aProfile->mBase[i]);
+		}
+	}
 
-		return TRUE;
+	iohub_cc1101_profile_stage(aCtx, aProfile, FALSE);
+
+	iohub_cc1101_wakeup(aCtx);
+	setIdleState(aCtx);
+
+	theRet = iohub_cc1101_flush_regs(aCtx);
+	if (theRet == SUCCESS)
+	{
+		aCtx->mProfile = aProfile;
+
+			//Autocal off: the synthesizer must hold values for the new frequency now, otherwise
+			//FS_AUTOCAL takes care of it on the next RX / TX
+		if (aCtx->mfSessionActive || aCtx->mfFscalCacheEnabled)
+			theRet = iohub_cc1101_fscal_restore(aCtx);
 	}
-	
-	return FALSE;
-	*/
+	else
+		aCtx->mProfile = NULL;
+
+	if (aCtx->mfSessionActive)
+		setRxState(aCtx);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
 }
 
+/* -------------------------------------------------------------- */
+
+const cc1101_profile *iohub_cc1101_find_profile(const cc1101_profile *aProfiles, u8 aCount, const char *aName)
+{
+	for (u8 i=0; i<aCount; i++)
+	{
+		if (strcmp(aProfiles[i].mName, aName) == 0)
+			return &aProfiles[i];
+	}
+
+	return NULL;
+}
 
 /* -------------------------------------------------------------- */
 
-ret_code_t iohub_cc1101_set_receive(cc1101_ctx *aCtx)
+/*
+	Asynchronous serial receive
+	======================
+	No packet handling in the chip: GDO2 outputs the demodulated OOK signal and the existing
+	digital_async_receiver decoders run on it, with the CC1101 filtering / AGC in front instead of
+	a superheterodyne module. The radio stays awake in RX until async_receive_end().
+*/
+
+ret_code_t iohub_cc1101_async_receive_begin(cc1101_ctx *aCtx, const cc1101_profile *aProfile, digital_async_receiver *aReceiver)
 {
-	LOG_DEBUG_CC1101("Enter in RX state !");
-	
-	IOHUB_ASSERT(aCtx->mWakeupCount > 0);
-	
+	ret_code_t theRet;
+
+	if (aCtx->mAsyncReceiver != NULL || aCtx->mfSessionActive || aCtx->mfWorActive)
+		return E_INVALID_STATE;
+
+	if (!iohub_cc1101_has_gdo2(aCtx) || aReceiver->mPin != aCtx->mGDO2Pin)
+		return E_INVALID_PARAMETERS;
+
+	theRet = iohub_cc1101_apply_profile(aCtx, aProfile);
+	if (theRet != SUCCESS)
+		return theRet;
+
+	if ((aCtx->mRegs[CC1101_PKTCTRL0] & CC1101_PKTCTRL0_FORMAT_MASK) != CC1101_PKTCTRL0_FORMAT_ASYNC ||
+		aCtx->mRegs[CC1101_IOCFG2] != CC1101_IOCFG_SERIAL_DATA)
+	{
+		LOG_ERROR_CC1101("Profile %s is not an asynchronous serial profile on GDO2", aProfile->mName);
+		return E_INVALID_PARAMETERS;
+	}
+
+		//Held until async_receive_end()
+	iohub_cc1101_wakeup(aCtx);
+	aCtx->mAsyncReceiver = aReceiver;
+
 	setIdleState(aCtx);
 	flushRxFifo(aCtx);
-		
 	setRxState(aCtx);
-	
-	(void)iohub_cc1101_wait_for_state(aCtx, STATE_RX, 1000);
-	
+
+	if (!iohub_cc1101_wait_for_state(aCtx, STATE_RX, 2))
+	{
+		aCtx->mAsyncReceiver = NULL;
+		(void)iohub_cc1101_standby(aCtx);
+		return E_TIMEOUT;
+	}
+
+	iohub_digital_async_receiver_start(aReceiver);
+
 	return SUCCESS;
 }
 
 /* -------------------------------------------------------------- */
 
-ret_code_t iohub_cc1101_receive_data(cc1101_ctx *aCtx, cc1101_packet_ctx *aPacket)
+	//The radio is left in the asynchronous profile, apply a packet profile before sending / receiving packets
+ret_code_t iohub_cc1101_async_receive_end(cc1101_ctx *aCtx)
 {
-	ret_code_t theErr = SUCCESS;
-	
-    aPacket->mLength = 0;
-	
+	if (aCtx->mAsyncReceiver == NULL)
+		return E_INVALID_STATE;
+
+	iohub_digital_async_receiver_stop(aCtx->mAsyncReceiver);
+
+	setIdleState(aCtx);
+	aCtx->mAsyncReceiver = NULL;
+	iohub_cc1101_clear_rx_event(aCtx);
+
+	return iohub_cc1101_standby(aCtx);
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_session_begin(cc1101_ctx *aCtx, BOOL afListen)
+{
+	ret_code_t theRet;
+
+	if (aCtx->mfSessionActive || aCtx->mfWorActive || aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+		//Held until session_end()
 	iohub_cc1101_wakeup(aCtx);
-	
-	u8 theValue = iohub_cc1101_read_status_reg(aCtx, CC1101_RXBYTES);
-	if (theValue & 0x80) //RX fifo overflow
+
+	aCtx->mSessionSavedRegs[0] = aCtx->mRegs[CC1101_MCSM1];
+	aCtx->mSessionSavedRegs[1] = aCtx->mRegs[CC1101_MCSM0];
+
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, (aCtx->mRegs[CC1101_MCSM1] & ~(CC1101_MCSM1_RXOFF_MASK | CC1101_MCSM1_TXOFF_MASK)) |
+											 CC1101_MCSM1_RXOFF_RX | CC1101_MCSM1_TXOFF_RX);
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, (aCtx->mRegs[CC1101_MCSM0] & ~CC1101_MCSM0_FS_AUTOCAL_MASK) | CC1101_MCSM0_FS_AUTOCAL_NEVER);
+
+	setIdleState(aCtx);
+
+	theRet = iohub_cc1101_flush_regs(aCtx);
+	if (theRet == SUCCESS)
+		theRet = iohub_cc1101_fscal_restore(aCtx);
+
+	if (theRet != SUCCESS)
 	{
-		LOG_ERROR_CC1101("RX FIFO Overflow, drop packets");
-		
-		iohub_cc1101_set_receive(aCtx); //Re-enter in RX State
-		
-		theErr = E_READ_ERROR;
+		iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, aCtx->mSessionSavedRegs[0]);
+		iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, aCtx->mSessionSavedRegs[1]);
+		(void)iohub_cc1101_flush_regs(aCtx);
+		(void)iohub_cc1101_standby(aCtx);
+		return theRet;
 	}
-	else if (theValue > 0)
+
+	aCtx->mfSessionActive = TRUE;
+
+	flushRxFifo(aCtx);
+	flushTxFifo(aCtx);
+	iohub_cc1101_clear_rx_event(aCtx);
+
+	if (!afListen)
+		return iohub_cc1101_strobe(aCtx, CC1101_SFSTXON);
+
+	setRxState(aCtx);
+	return iohub_cc1101_wait_for_state(aCtx, STATE_RX, 2) ? SUCCESS : E_TIMEOUT;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_session_end(cc1101_ctx *aCtx)
+{
+	if (!aCtx->mfSessionActive)
+		return E_INVALID_STATE;
+
+	setIdleState(aCtx);
+	aCtx->mfSessionActive = FALSE;
+
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM1, aCtx->mSessionSavedRegs[0]);
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, aCtx->mSessionSavedRegs[1]);
+
+	ret_code_t theRet = iohub_cc1101_flush_regs(aCtx);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_transceive(cc1101_ctx *aCtx, cc1101_packet_ctx *aRequest, cc1101_packet_ctx *aResponse, u32 aTimeoutMs)
+{
+	BOOL 		theOwnSession = !aCtx->mfSessionActive;
+	ret_code_t 	theRet = SUCCESS;
+
+	aResponse->mLength = 0;
+
+	if (theOwnSession)
+		theRet = iohub_cc1101_session_begin(aCtx, FALSE);
+
+	if (theRet == SUCCESS)
+		theRet = iohub_cc1101_send_data(aCtx, aRequest);
+
+	if (theRet == SUCCESS)
+		theRet = iohub_cc1101_receive_data_timeout(aCtx, aResponse, aTimeoutMs);
+
+	if (theOwnSession && aCtx->mfSessionActive)
+		(void)iohub_cc1101_session_end(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+s16 iohub_cc1101_rssi_to_dbm(u8 aRSSI)
+{
+	return (s16)((s8)aRSSI) / 2 - CC1101_RSSI_OFFSET_DB;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Like fscal_restore() but from the per channel scan table, radio must be IDLE
+static ret_code_t iohub_cc1101_scan_fscal_restore(cc1101_ctx *aCtx)
+{
+#if CC1101_SCAN_FSCAL_CHANNELS > 0
+	cc1101_scan_fscal 	*theTable = &aCtx->mScanFscal;
+	u16 				theChannel = aCtx->mRegs[CC1101_CHANNR];
+	ret_code_t 			theRet;
+
+	if (theChannel >= CC1101_SCAN_FSCAL_CHANNELS)
+		return iohub_cc1101_fscal_restore(aCtx);
+
+	if (theTable->mFreq != iohub_cc1101_fscal_freq(aCtx) || theTable->mTempBucket != aCtx->mFscalTempBucket)
+	{
+		memset(theTable->mValid, 0x00, sizeof(theTable->mValid));
+		theTable->mFreq = iohub_cc1101_fscal_freq(aCtx);
+		theTable->mTempBucket = aCtx->mFscalTempBucket;
+	}
+
+	if (theTable->mValid[theChannel / 8] & (1 << (theChannel % 8)))
+		return iohub_cc1101_fscal_write(aCtx, theTable->mFscal[theChannel]);
+
+	theRet = iohub_cc1101_fscal_calibrate(aCtx);
+	if (theRet != SUCCESS)
+		return theRet;
+
+	memcpy(theTable->mFscal[theChannel], &aCtx->mRegs[CC1101_FSCAL3], sizeof(theTable->mFscal[theChannel]));
+	theTable->mValid[theChannel / 8] |= (1 << (theChannel % 8));
+
+	return SUCCESS;
+#else
+	return iohub_cc1101_fscal_restore(aCtx);
+#endif
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_scan(cc1101_ctx *aCtx, u8 aFirstChannel, u8 aChannelCount, u32 aDwellUs, s16 *aRssiDbm, s16 *aNoiseFloorDbm)
+{
+	ret_code_t 	theRet = SUCCESS;
+	u8 			theSavedChannel = aCtx->mRegs[CC1101_CHANNR];
+	u8 			theSavedMCSM0 = aCtx->mRegs[CC1101_MCSM0];
+	u8 			theSavedFscal[3];
+	u8 			i;
+
+	if (aChannelCount == 0 || aRssiDbm == NULL)
+		return E_INVALID_PARAMETERS;
+
+	if (aCtx->mfSessionActive || aCtx->mfWorActive || aCtx->mAsyncReceiver != NULL)
+		return E_INVALID_STATE;
+
+	iohub_cc1101_wakeup(aCtx);
+	setIdleState(aCtx);
+
+		//Calibration is handled here, once per channel. The chip values for the current channel come back at the end
+	theRet = iohub_cc1101_read_burst_reg(aCtx, CC1101_FSCAL3, theSavedFscal, sizeof(theSavedFscal));
+	if (theRet != SUCCESS)
+	{
+		(void)iohub_cc1101_standby(aCtx);
+		return theRet;
+	}
+
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, (theSavedMCSM0 & ~CC1101_MCSM0_FS_AUTOCAL_MASK) | CC1101_MCSM0_FS_AUTOCAL_NEVER);
+
+	for (i=0; i<aChannelCount && theRet == SUCCESS; i++)
+	{
+		setIdleState(aCtx);
+
+		iohub_cc1101_set_reg(aCtx, CC1101_CHANNR, (u8)(aFirstChannel + i));
+		theRet = iohub_cc1101_flush_regs(aCtx);
+		if (theRet == SUCCESS)
+			theRet = iohub_cc1101_scan_fscal_restore(aCtx);
+		if (theRet != SUCCESS)
+			break;
+
+		setRxState(aCtx);
+		iohub_time_delay_us(CC1101_RSSI_SETTLE_US + aDwellUs);
+
+		aRssiDbm[i] = iohub_cc1101_rssi_to_dbm(iohub_cc1101_read_status_reg(aCtx, CC1101_RSSI));
+	}
+
+	setIdleState(aCtx);
+	flushRxFifo(aCtx);
+
+	iohub_cc1101_set_reg(aCtx, CC1101_CHANNR, theSavedChannel);
+	iohub_cc1101_set_reg(aCtx, CC1101_MCSM0, theSavedMCSM0);
+	if (iohub_cc1101_flush_regs(aCtx) == SUCCESS)
+		(void)iohub_cc1101_fscal_write(aCtx, theSavedFscal);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	if (theRet == SUCCESS && aNoiseFloorDbm != NULL)
 	{
-		aPacket->mLength = theValue & 0x7F;
+			//Median: busy channels do not pull the estimate up. Counting sort, RSSI only spans 128 values
+		u8 theHistogram[128];
+		u8 theRank = 0;
+		u8 theBin = 0;
+
+		memset(theHistogram, 0x00, sizeof(theHistogram));
+		for (i=0; i<aChannelCount; i++)
+			theHistogram[(aRssiDbm[i] - iohub_cc1101_rssi_to_dbm(0x80)) & 0x7F]++;
 
-		if (aPacket->mLength != 0) //RX bytes pending ?
+		for (theBin=0; theBin<sizeof(theHistogram) - 1; theBin++)
 		{
-			LOG_DEBUG_CC1101("Reading data from FIFO (Len: %d)...", aPacket->mLength);
-			
-				// Read data packet
-			iohub_cc1101_read_burst_reg(aCtx, CC1101_RXFIFO, aPacket->mData, aPacket->mLength);
+			theRank += theHistogram[theBin];
+			if (theRank > aChannelCount / 2)
+				break;
+		}
+
+		*aNoiseFloorDbm = iohub_cc1101_rssi_to_dbm(0x80) + theBin;
+	}
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_set_reg(cc1101_ctx *aCtx, u8 aRegAddr, u8 aValue)
+{
+	IOHUB_ASSERT(aRegAddr < CC1101_REGISTERS_COUNT);
+	IOHUB_ASSERT(aCtx->mfRegsValid);
+
+	if (aCtx->mRegs[aRegAddr] == aValue)
+		return;
+
+	aCtx->mRegs[aRegAddr] = aValue;
+	aCtx->mDirtyRegs |= (1ULL << aRegAddr);
+}
+
+/* -------------------------------------------------------------- */
+
+u8 iohub_cc1101_get_reg(cc1101_ctx *aCtx, u8 aRegAddr)
+{
+	IOHUB_ASSERT(aRegAddr < CC1101_REGISTERS_COUNT);
+
+	return aCtx->mRegs[aRegAddr];
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_flush_regs(cc1101_ctx *aCtx)
+{
+	u8 			theBuffer[CC1101_REGISTERS_COUNT];
+	ret_code_t	theRet = SUCCESS;
+	u8			theStart = 0;
+
+	if (aCtx->mDirtyRegs == 0)
+		return SUCCESS;
 
-		    theValue = iohub_cc1101_read_status_reg(aCtx, CC1101_LQI);
-			aPacket->mLinkQualityIndex = (theValue & 0x7F);
-			aPacket->mfCrcOk = (theValue & 0x80) ? TRUE : FALSE;
-			aPacket->mRSSI = iohub_cc1101_read_status_reg(aCtx, CC1101_RSSI);
-			
-			iohub_cc1101_set_receive(aCtx); //Re-enter in RX State
+	iohub_cc1101_wakeup(aCtx);
+
+	while (theStart < CC1101_REGISTERS_COUNT && theRet == SUCCESS)
+	{
+		if ((aCtx->mDirtyRegs & (1ULL << theStart)) == 0)
+		{
+			theStart++;
+			continue;
 		}
-		else
+
+			//Extend the range while the next dirty register is close enough
+		u8 theEnd = theStart + 1;
+		for (u8 i=theEnd; i<CC1101_REGISTERS_COUNT && i<=theEnd + CC1101_FLUSH_MERGE_GAP; i++)
 		{
-			LOG_DEBUG_CC1101("No data pending");
+			if (aCtx->mDirtyRegs & (1ULL << i))
+				theEnd = i + 1;
 		}
+
+		memcpy(theBuffer, &aCtx->mRegs[theStart], theEnd - theStart);
+		theRet = iohub_cc1101_write_burst_reg(aCtx, theStart, theBuffer, theEnd - theStart);
+
+		theStart = theEnd;
 	}
-	
-    (void)iohub_cc1101_standby(aCtx);
-	
-	return theErr;
+
+	if (theRet == SUCCESS)
+		aCtx->mDirtyRegs = 0;
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_set_channel(cc1101_ctx *aCtx, u8 aChannel)
+{
+	iohub_cc1101_set_reg(aCtx, CC1101_CHANNR, aChannel);
+
+	if (!aCtx->mfSessionActive && !aCtx->mfFscalCacheEnabled)
+		return iohub_cc1101_flush_regs(aCtx);
+
+		//Autocal is off: cached FSCAL values (or one calibration) for the new channel, then back to RX if needed
+	BOOL theWasRx = (aCtx->mfSessionActive || (aCtx->mWakeupCount > 0 && iohub_cc1101_get_state(aCtx) == STATE_RX)) ? TRUE : FALSE;
+
+	iohub_cc1101_wakeup(aCtx);
+	setIdleState(aCtx);
+
+	ret_code_t theRet = iohub_cc1101_flush_regs(aCtx);
+	if (theRet == SUCCESS)
+		theRet = iohub_cc1101_fscal_restore(aCtx);
+
+	if (theWasRx)
+		setRxState(aCtx);
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_set_pa_power(cc1101_ctx *aCtx, u8 aPaTable)
+{
+	ret_code_t theRet;
+
+	if (aCtx->mPaTable == aPaTable)
+		return SUCCESS;
+
+	iohub_cc1101_wakeup(aCtx);
+
+	u8 theByte = aPaTable; //Overwritten by the status byte
+
+	theRet = iohub_cc1101_write_burst_reg(aCtx, CC1101_PATABLE, &theByte, sizeof(theByte));
+	if (theRet == SUCCESS)
+		aCtx->mPaTable = aPaTable;
+
+	(void)iohub_cc1101_standby(aCtx);
+
+	return theRet;
 }
@@ -9,11 +9,34 @@
 #	define LOG_ERROR_SAUTER(...)				do{}while(0)
 #endif
 
+#define SAUTER_HEATER_STX					0x20
+#define SAUTER_HEATER_ETX					0x77
+#define SAUTER_HEATER_ADDRESS				0x00	//CC1101 address byte, before the frame
+
+#define SAUTER_HEATER_OFFSET_ID				1
+#define SAUTER_HEATER_OFFSET_MODE			5
+#define SAUTER_HEATER_OFFSET_TEMP			6
+#define SAUTER_HEATER_OFFSET_CRC			22
+#define SAUTER_HEATER_OFFSET_ETX			23
+
+#define SAUTER_HEATER_MODE_OFF				0x00
+#define SAUTER_HEATER_MODE_ON				0x01
+#define SAUTER_HEATER_MODE_BOOST			0x02
+
+static const u8 sSauterFrameTemplate[SAUTER_HEATER_FRAME_LEN] =
+{
+	SAUTER_HEATER_STX, 0x5A, 0xB5, 0x07, 0x52, 0x00/*Mode*/, 0x00/*Temp*/, 0x00, 0x54, 0x00, 0x00, 0x00,
+	0x62, 0x00, 0x56/*??*/, 0x02/*??*/, 0x70, 0x00, 0x00, 0x00, 0x08, 0x0B, 0x00/*CRC*/, SAUTER_HEATER_ETX
+};
+
+/* -------------------------------------------------------------------- */
+
 ret_code_t iohub_sauter_heater_init(sauter_heater *aCtx, cc1101_ctx *aCC1101)
 {
     memset(aCtx, 0x00, sizeof(sauter_heater));
 	
 	aCtx->mCC1101 = aCC1101;
+	memcpy(aCtx->mFrame, sSauterFrameTemplate, sizeof(aCtx->mFrame));
 	
 	return SUCCESS;
 }
@@ -25,27 +48,174 @@ void iohub_sauter_heater_uninit(sauter_heater *aCtx)
 }
 
 /* -------------------------------------------------------------------- */
-#define SAUTER_HEATER_OFFSET_MODE			5
-#define SAUTER_HEATER_OFFSET_TEMP			6
-#define SAUTER_HEATER_OFFSET_CRC			22
 
+void iohub_sauter_heater_set_id(sauter_heater *aCtx, const u8 anId[SAUTER_HEATER_ID_LEN])
+{
+	memcpy(&aCtx->mFrame[SAUTER_HEATER_OFFSET_ID], anId, SAUTER_HEATER_ID_LEN);
+	aCtx->mfStateValid = FALSE;
+}
 
-ret_code_t iohub_sauter_heater_send(sauter_heater *aCtx, BOOL afOn, float aTemperature, float aBoostTimeMinute)
+/* -------------------------------------------------------------------- */
+
+	//Only the mode, temperature and CRC bytes of the heater frame change
+static ret_code_t iohub_sauter_heater_build(sauter_heater *aCtx, const sauter_heater_command *aCommand, cc1101_packet_ctx *aPacket)
 {
-	u8 buf[32] = {0x20/*STX*/, 0x5A,0xB5,0x07,0x52,0x00/*Mode*/,0x00/*Temp*/,0x00,0x54,0x00,0x00,0x00,0x62,0x00,0x56/*??*/,0x02/*??*/,0x70,0x00,0x00,0x00,0x08,0x0B,0x00/*CRC*/,0x77/*ETX*/};
+	if (aCommand->mTemperature < SAUTER_HEATER_TEMP_MIN || aCommand->mTemperature > SAUTER_HEATER_TEMP_MAX)
+		return E_INVALID_PARAMETERS;
 
-	//float theDiff = (aTemperature - 12.0);
-	//u8 theTempIdx = (u8)(theDiff * 2.0);
-	
-	buf[SAUTER_HEATER_OFFSET_CRC] = iohub_sauter_heater_crc(buf, sizeof(buf) - 2); //-2 = Footer + CRC
+	u8 *theFrame = aCtx->mFrame;
+
+	if (!aCommand->mfOn)
+		theFrame[SAUTER_HEATER_OFFSET_MODE] = SAUTER_HEATER_MODE_OFF;
+	else
+		theFrame[SAUTER_HEATER_OFFSET_MODE] = (aCommand->mBoostTimeMinute > 0) ? SAUTER_HEATER_MODE_BOOST : SAUTER_HEATER_MODE_ON;
+
+	theFrame[SAUTER_HEATER_OFFSET_TEMP] = (u8)((aCommand->mTemperature - SAUTER_HEATER_TEMP_MIN) / SAUTER_HEATER_TEMP_STEP + 0.5f);
+	theFrame[SAUTER_HEATER_OFFSET_CRC] = iohub_sauter_heater_crc(theFrame, SAUTER_HEATER_OFFSET_CRC);
+
+	aPacket->mDst = SAUTER_HEATER_ADDRESS;
+	aPacket->mLength = SAUTER_HEATER_FRAME_LEN;
+	memcpy(aPacket->mData, theFrame, SAUTER_HEATER_FRAME_LEN);
 
 	return SUCCESS;
 }
 
+/* -------------------------------------------------------------------- */
+
+	//Heater answer: same layout, same identifier, valid CRC
+static BOOL iohub_sauter_heater_parse_ack(sauter_heater *aCtx, const sauter_heater_command *aCommand, const cc1101_packet_ctx *aPacket)
+{
+	const u8 *theFrame = aPacket->mData;
+
+	if (aPacket->mLength != SAUTER_HEATER_FRAME_LEN ||
+		theFrame[0] != SAUTER_HEATER_STX || theFrame[SAUTER_HEATER_OFFSET_ETX] != SAUTER_HEATER_ETX)
+		return FALSE;
+
+	if (iohub_sauter_heater_crc((u8 *)theFrame, SAUTER_HEATER_OFFSET_CRC) != theFrame[SAUTER_HEATER_OFFSET_CRC])
+	{
+		LOG_ERROR_SAUTER("Sauter: bad CRC in answer");
+		return FALSE;
+	}
+
+	if (memcmp(&theFrame[SAUTER_HEATER_OFFSET_ID], &aCtx->mFrame[SAUTER_HEATER_OFFSET_ID], SAUTER_HEATER_ID_LEN) != 0)
+		return FALSE;
+
+		//State reported by the heater, the boost duration is not part of the frame
+	aCtx->mfOn = (theFrame[SAUTER_HEATER_OFFSET_MODE] != SAUTER_HEATER_MODE_OFF) ? TRUE : FALSE;
+	aCtx->mTemperature = SAUTER_HEATER_TEMP_MIN + theFrame[SAUTER_HEATER_OFFSET_TEMP] * SAUTER_HEATER_TEMP_STEP;
+	aCtx->mBoostTimeMinute = (theFrame[SAUTER_HEATER_OFFSET_MODE] == SAUTER_HEATER_MODE_BOOST) ? aCommand->mBoostTimeMinute : 0;
+	aCtx->mfStateValid = TRUE;
+
+	return TRUE;
+}
+
+/* -------------------------------------------------------------------- */
+
+	//Radio is in a transceiver session: TX ends in RX, the answer is caught without any turnaround delay
+static ret_code_t iohub_sauter_heater_exchange(const sauter_heater_command *aCommand)
+{
+	sauter_heater		*theHeater = aCommand->mHeater;
+	cc1101_packet_ctx 	theRequest;
+	cc1101_packet_ctx 	theAnswer;
+	ret_code_t 			theRet;
+
+	theRet = iohub_sauter_heater_build(theHeater, aCommand, &theRequest);
+	if (theRet != SUCCESS)
+		return theRet;
+
+	for (u8 theTry=0; theTry<SAUTER_HEATER_RETRY_COUNT; theTry++)
+	{
+		theRet = iohub_cc1101_send_data(theHeater->mCC1101, &theRequest);
+		if (theRet != SUCCESS)
+		{
+			LOG_ERROR_SAUTER("Sauter: send failed %d", theRet);
+			continue;
+		}
+
+			//Other heaters / remotes may talk in between, wait for this heater frame
+		u32 theStartTimeMs = IOHUB_TIMER_START();
+		u32 theRemainingMs;
+
+		while ((theRemainingMs = iohub_time_remaining(theStartTimeMs, SAUTER_HEATER_ACK_TIMEOUT_MS)) > 0)
+		{
+			if (iohub_cc1101_receive_data_timeout(theHeater->mCC1101, &theAnswer, theRemainingMs) != SUCCESS)
+				break;
+
+			if (iohub_sauter_heater_parse_ack(theHeater, aCommand, &theAnswer))
+				return SUCCESS;
+		}
+
+		LOG_DEBUG_SAUTER("Sauter: no answer, try %u", theTry + 1);
+	}
+
+	return E_FAIL_ACK;
+}
+
+/* -------------------------------------------------------------------- */
+
+ret_code_t iohub_sauter_heater_send(sauter_heater *aCtx, BOOL afOn, float aTemperature, float aBoostTimeMinute)
+{
+	sauter_heater_command theCommand;
+
+	theCommand.mHeater = aCtx;
+	theCommand.mfOn = afOn;
+	theCommand.mTemperature = aTemperature;
+	theCommand.mBoostTimeMinute = aBoostTimeMinute;
+
+	return iohub_sauter_heater_send_batch(&theCommand, 1);
+}
+
+/* -------------------------------------------------------------------- */
+
+ret_code_t iohub_sauter_heater_send_batch(sauter_heater_command *aCommands, u8 aCount)
+{
+	cc1101_ctx	*theCC1101;
+	ret_code_t 	theRet;
+
+	if (aCount == 0)
+		return E_INVALID_PARAMETERS;
+
+	theCC1101 = aCommands[0].mHeater->mCC1101;
+
+	for (u8 i=0; i<aCount; i++)
+	{
+		if (aCommands[i].mHeater->mCC1101 != theCC1101)
+			return E_INVALID_PARAMETERS;
+
+		aCommands[i].mResult = E_INVALID_STATE;
+	}
+
+		//One wake-up and one calibration for the whole batch
+	theRet = iohub_cc1101_session_begin(theCC1101, FALSE);
+	if (theRet != SUCCESS)
+	{
+		LOG_ERROR_SAUTER("Sauter: cannot start radio session %d", theRet);
+		return theRet;
+	}
+
+	for (u8 i=0; i<aCount; i++)
+	{
+		aCommands[i].mResult = iohub_sauter_heater_exchange(&aCommands[i]);
+		if (aCommands[i].mResult != SUCCESS)
+			theRet = aCommands[i].mResult;
+	}
+
+	(void)iohub_cc1101_session_end(theCC1101);
+
+	return theRet;
+}
+
 /* -------------------------------------------------------------------- */
 
 ret_code_t iohub_sauter_heater_read(sauter_heater *aCtx, BOOL *afOn, float *aTemperature, float *aBoostTimeMinute)
 {
+	if (!aCtx->mfStateValid)
+		return E_INVALID_STATE;
+
+	*afOn = aCtx->mfOn;
+	*aTemperature = aCtx->mTemperature;
+	*aBoostTimeMinute = aCtx->mBoostTimeMinute;
+
 	return SUCCESS;
 }
 
@@ -1,5 +1,6 @@
 #include "heatpump/iohub_heatpump_midea.h"
 #include "utils/iohub_logs.h"
+#include "utils/iohub_tx_timing.h"
 
 #define HEATPUMP_R51L1_BGE_RECV_ACCURACY     0.2
 
@@ -66,8 +67,9 @@ void iohub_heatpump_midea_mark(heatpump_midea *ctx, u16 aTimeUs)
 	TIMER_ENABLE_PWM;
 	iohub_time_delay_us(aTimeUs);
 #else
-	iohub_digital_write(ctx->mDigitalPinTx, PinLevel_High);
-	iohub_time_delay_us(aTimeUs);
+	iohub_fast_gpio_set(&ctx->mTxGPIO);
+	IOHUB_TX_TIMING_RECORD(PinLevel_High, aTimeUs);
+	iohub_fast_gpio_delay_us(&ctx->mTxGPIO, aTimeUs);
 #endif
 }
 
@@ -79,8 +81,9 @@ void iohub_heatpump_midea_space(heatpump_midea *ctx, u16 aTimeUs)
 	TIMER_DISABLE_PWM;
 	iohub_time_delay_us(aTimeUs);
 #else
-	iohub_digital_write(ctx->mDigitalPinTx, PinLevel_Low);
-	iohub_time_delay_us(aTimeUs);
+	iohub_fast_gpio_clear(&ctx->mTxGPIO);
+	IOHUB_TX_TIMING_RECORD(PinLevel_Low, aTimeUs);
+	iohub_fast_gpio_delay_us(&ctx->mTxGPIO, aTimeUs);
 #endif
 }
 
@@ -91,8 +94,12 @@ ret_code_t iohub_heatpump_midea_init(heatpump_midea *ctx, digital_async_receiver
 	memset(ctx, 0x00, sizeof(heatpump_midea));
 
 	ctx->mDigitalPinTx = txPin;
+	ctx->mReceiver = receiver;
 	if (ctx->mDigitalPinTx != IOHUB_GPIO_PIN_INVALID)
+	{
 		iohub_digital_set_pin_mode(ctx->mDigitalPinTx, PinMode_Output);
+		iohub_fast_gpio_init(&ctx->mTxGPIO, ctx->mDigitalPinTx);
+	}
 
 	iohub_digital_async_receiver_register(receiver, iohub_heatpump_midea_get_interface(), ctx);
  
@@ -103,6 +110,8 @@ ret_code_t iohub_heatpump_midea_init(heatpump_midea *ctx, digital_async_receiver
 
 void iohub_heatpump_midea_uninit(heatpump_midea *ctx)
 {
+	if (ctx->mDigitalPinTx != IOHUB_GPIO_PIN_INVALID)
+		iohub_fast_gpio_uninit(&ctx->mTxGPIO);
 }
 
 /* ----------------------------------------------------------------- */
@@ -216,9 +225,19 @@ ret_code_t iohub_heatpump_midea_set_state(heatpump_midea *ctx, const IoHubHeatpu
 	LOG_DEBUG("Midea: Sending");
 	LOG_BUFFER(theData, sizeof(theData));
 	
+	if (ctx->mReceiver != NULL)
+		iohub_digital_async_receiver_tx_begin(ctx->mReceiver, RECEIVER_HEATPUMP_MIDEA_ID, theData, sizeof(theData));
+
+	iohub_fast_gpio_waveform_begin(&ctx->mTxGPIO);
+
 	for (u8 k = 0; k < 2; k++) //Send code 2 times
 		iohub_heatpump_midea_send_nec(ctx, theData);
 
+	iohub_fast_gpio_waveform_end(&ctx->mTxGPIO);
+
+	if (ctx->mReceiver != NULL)
+		iohub_digital_async_receiver_tx_end(ctx->mReceiver);
+
 	return SUCCESS;
 }
 
@@ -260,26 +279,39 @@ BOOL iohub_heatpump_midea_read_bit(heatpump_midea *ctx, u8 *aBit)
 
 /* ----------------------------------------------------- */
 
-ret_code_t iohub_heatpump_midea_get_state(heatpump_midea *ctx, IoHubHeatpumpSettings *aSettings) 
+static BOOL iohub_heatpump_midea_read_data(heatpump_midea *ctx, u8 aData[6]) 
 {
 	u8          theBit = 0;
-	u8	 		theData[6] = {0x00};
+
+	memset(aData, 0x00, 6);
 	
 		//Header
 	iohub_heatpump_midea_read_timing(ctx); //NEC_CLIM_HDR_MARK
 	iohub_heatpump_midea_read_timing(ctx); //NEC_CLIM_HDR_SPACE
 
-	for (u8 i = 0; i < sizeof(theData); i++)
+	for (u8 i = 0; i < 6; i++)
 	{
 		for (u8 k = 0; k < 8; k++)
 		{
 			if (!iohub_heatpump_midea_read_bit(ctx, &theBit))
-				return E_INVALID_DATA;
+				return FALSE;
 			
-			theData[i] <<= 1;
-			theData[i] |= theBit;
+			aData[i] <<= 1;
+			aData[i] |= theBit;
 		}
 	}
+
+	return TRUE;
+}
+
+/* ----------------------------------------------------- */
+
+ret_code_t iohub_heatpump_midea_get_state(heatpump_midea *ctx, IoHubHeatpumpSettings *aSettings) 
+{
+	u8	 		theData[6];
+	
+	if (!iohub_heatpump_midea_read_data(ctx, theData))
+		return E_INVALID_DATA;
 	
 	LOG_DEBUG("Received:");
 	LOG_BUFFER(theData, sizeof(theData));
@@ -393,6 +425,25 @@ BOOL iohub_heatpump_midea_detectPacket(digital_async_receiver_interface_ctx *ctx
 
 /* ----------------------------------------------------- */
 
+u8 iohub_heatpump_midea_getPayload(digital_async_receiver_interface_ctx *ctx, u8 *aBuffer, u8 aBufferLen)
+{
+	heatpump_midea *theCtx = (heatpump_midea *)ctx;
+	u16			theReadIdx = theCtx->mTimingReadIdx;
+	BOOL		theRet;
+
+	if (aBufferLen < 6)
+		return 0;
+
+		//Raw bytes as sent by set_state, decoded without consuming the frame
+	theCtx->mTimingReadIdx = 0;
+	theRet = iohub_heatpump_midea_read_data(theCtx, aBuffer);
+	theCtx->mTimingReadIdx = theReadIdx;
+
+	return theRet ? 6 : 0;
+}
+
+/* ----------------------------------------------------- */
+
 void iohub_heatpump_midea_packetHandled(digital_async_receiver_interface_ctx *ctx)
 {
 	heatpump_midea *theCtx = (heatpump_midea *)ctx;
@@ -420,7 +471,8 @@ const digital_async_receiver_interface	*iohub_heatpump_midea_get_interface(void)
 	{
 		RECEIVER_HEATPUMP_MIDEA_ID,
 		iohub_heatpump_midea_detectPacket,
-		iohub_heatpump_midea_packetHandled
+		iohub_heatpump_midea_packetHandled,
+		iohub_heatpump_midea_getPayload
 	};
 	
 	return &sInterface;
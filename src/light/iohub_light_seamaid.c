@@ -1,4 +1,5 @@
 #include "light/iohub_light_seamaid.h"
+#include "utils/iohub_tx_timing.h"
 
 //#define DEBUG
 #ifdef DEBUG
@@ -10,6 +11,7 @@
 #endif
 
 #define DRV_LIGHT_SEAMAID_RECV_ACCURACY     0.15
+#define DRV_LIGHT_SEAMAID_PAYLOAD_LEN		3
 
 #define DRV_LIGHT_SEAMAID_BIT_LOW			250
 #define DRV_LIGHT_SEAMAID_BIT_HIGH			1250
@@ -19,12 +21,19 @@
 #define DRV_LIGHT_SEAMAID_START_BIT_1		2900
 #define DRV_LIGHT_SEAMAID_START_BIT_2		9400
 
+#define DRV_LIGHT_SEAMAID_FRAME_GAP_MS		2
+
 #ifdef ARDUINO
-	#define 	DRV_LIGHT_SEAMAID_WRITE(aLevel)	iohub_digital_write_4(aLevel)
+	#define 	DRV_LIGHT_SEAMAID_WRITE(aLevel)		iohub_digital_write_4(aLevel)
+	#define 	DRV_LIGHT_SEAMAID_DELAY_US(aUs)		iohub_time_delay_us(aUs)
 #else
-	#define 	DRV_LIGHT_SEAMAID_WRITE(aLevel)	iohub_digital_write(aCtx->mDigitalPinTx, aLevel)
+	#define 	DRV_LIGHT_SEAMAID_WRITE(aLevel)		iohub_fast_gpio_write(&aCtx->mTxGPIO, aLevel)
+	#define 	DRV_LIGHT_SEAMAID_DELAY_US(aUs)		iohub_fast_gpio_delay_us(&aCtx->mTxGPIO, aUs)
 #endif
 
+#define DRV_LIGHT_SEAMAID_PULSE(aLevel, aDurationUs) \
+	do { DRV_LIGHT_SEAMAID_WRITE(aLevel); IOHUB_TX_TIMING_RECORD(aLevel, aDurationUs); DRV_LIGHT_SEAMAID_DELAY_US(aDurationUs); } while(0)
+
 /* ----------------------------------------------------------------- */
 
 int iohub_light_seamaid_init(light_seamaid *aCtx, u8 aGPIOTx)
@@ -36,7 +45,10 @@ int iohub_light_seamaid_init(light_seamaid *aCtx, u8 aGPIOTx)
     aCtx->mDigitalPinTx = aGPIOTx;
 	
     if (aCtx->mDigitalPinTx != IOHUB_GPIO_PIN_INVALID)
+    {
         iohub_digital_set_pin_mode(aCtx->mDigitalPinTx, PinMode_Output);
+        iohub_fast_gpio_init(&aCtx->mTxGPIO, aCtx->mDigitalPinTx);
+    }
 	
     return theRet;
 }
@@ -45,6 +57,15 @@ int iohub_light_seamaid_init(light_seamaid *aCtx, u8 aGPIOTx)
 
 void iohub_light_seamaid_uninit(light_seamaid *aCtx)
 {
+    if (aCtx->mDigitalPinTx != IOHUB_GPIO_PIN_INVALID)
+        iohub_fast_gpio_uninit(&aCtx->mTxGPIO);
+}
+
+/* ----------------------------------------------------------------- */
+
+void iohub_light_seamaid_attach_receiver(light_seamaid *aCtx, digital_async_receiver *aReceiver)
+{
+    aCtx->mReceiver = aReceiver;
 }
 
 /* ----------------------------------------------------- */
@@ -53,34 +74,45 @@ void iohub_light_seamaid_send_bit(light_seamaid *aCtx, u8 aBit)
 {
 	if (aBit)
 	{
-		DRV_LIGHT_SEAMAID_WRITE(PinLevel_High);
-		iohub_time_delay_us(DRV_LIGHT_SEAMAID_BIT_HIGH);
-		
-		DRV_LIGHT_SEAMAID_WRITE(PinLevel_Low);
-		iohub_time_delay_us(DRV_LIGHT_SEAMAID_BIT_LOW);
+		DRV_LIGHT_SEAMAID_PULSE(PinLevel_High, DRV_LIGHT_SEAMAID_BIT_HIGH);
+		DRV_LIGHT_SEAMAID_PULSE(PinLevel_Low, DRV_LIGHT_SEAMAID_BIT_LOW);
 	}
 	else
 	{
-		DRV_LIGHT_SEAMAID_WRITE(PinLevel_High);
-		iohub_time_delay_us(DRV_LIGHT_SEAMAID_BIT_LOW);
-		
-		DRV_LIGHT_SEAMAID_WRITE(PinLevel_Low);
-		iohub_time_delay_us(DRV_LIGHT_SEAMAID_BIT_HIGH);
+		DRV_LIGHT_SEAMAID_PULSE(PinLevel_High, DRV_LIGHT_SEAMAID_BIT_LOW);
+		DRV_LIGHT_SEAMAID_PULSE(PinLevel_Low, DRV_LIGHT_SEAMAID_BIT_HIGH);
 	}
 }
 
+/* ----------------------------------------------------- */
+
+	//Echo matching payload, same layout for send and receive
+static u8 iohub_light_seamaid_pack_payload(u8 *aBuffer, u16 anAddr, u8 aCmd)
+{
+	aBuffer[0] = (u8)(anAddr >> 8);
+	aBuffer[1] = (u8)anAddr;
+	aBuffer[2] = aCmd;
+
+	return DRV_LIGHT_SEAMAID_PAYLOAD_LEN;
+}
+
 /* ----------------------------------------------------- */
 
 void iohub_light_seamaid_send(light_seamaid *aCtx, u16 anAddr, u8 aCmd)
 {
+	u8			thePayload[DRV_LIGHT_SEAMAID_PAYLOAD_LEN];
+
+	if (aCtx->mReceiver != NULL)
+		iohub_digital_async_receiver_tx_begin(aCtx->mReceiver, DRV_LIGHT_SEAMAID_ID, thePayload,
+											  iohub_light_seamaid_pack_payload(thePayload, anAddr, aCmd));
+
+	iohub_fast_gpio_waveform_begin(&aCtx->mTxGPIO);
+
 	for (int k=0; k<4; k++) //Send data 4 times
 	{
 			//Header
-		DRV_LIGHT_SEAMAID_WRITE(PinLevel_High);
-		iohub_time_delay_us(DRV_LIGHT_SEAMAID_START_BIT_1);
-		
-		DRV_LIGHT_SEAMAID_WRITE(PinLevel_Low);
-		iohub_time_delay_us(DRV_LIGHT_SEAMAID_START_BIT_2);   
+		DRV_LIGHT_SEAMAID_PULSE(PinLevel_High, DRV_LIGHT_SEAMAID_START_BIT_1);
+		DRV_LIGHT_SEAMAID_PULSE(PinLevel_Low, DRV_LIGHT_SEAMAID_START_BIT_2);
 	 
 			//Send Addr
 		for (int i = 0; i < 16; i++)
@@ -91,13 +123,18 @@ void iohub_light_seamaid_send(light_seamaid *aCtx, u16 anAddr, u8 aCmd)
 			iohub_light_seamaid_send_bit(aCtx, (aCmd >> (7 - i)) & 0x01);
 		
 			//Footer
-		DRV_LIGHT_SEAMAID_WRITE(PinLevel_High);
-		iohub_time_delay_us(DRV_LIGHT_SEAMAID_BIT_HIGH);
-		DRV_LIGHT_SEAMAID_WRITE(PinLevel_Low);
-		iohub_time_delay_us(DRV_LIGHT_SEAMAID_BIT_HIGH);   
+		DRV_LIGHT_SEAMAID_PULSE(PinLevel_High, DRV_LIGHT_SEAMAID_BIT_HIGH);
+		DRV_LIGHT_SEAMAID_PULSE(PinLevel_Low, DRV_LIGHT_SEAMAID_BIT_HIGH);
 
-		iohub_time_delay_ms(2);
+			//Inter frame gap, pin stays low
+		IOHUB_TX_TIMING_RECORD(PinLevel_Low, DRV_LIGHT_SEAMAID_FRAME_GAP_MS * 1000);
+		DRV_LIGHT_SEAMAID_DELAY_US(DRV_LIGHT_SEAMAID_FRAME_GAP_MS * 1000);
 	}
+
+	iohub_fast_gpio_waveform_end(&aCtx->mTxGPIO);
+
+	if (aCtx->mReceiver != NULL)
+		iohub_digital_async_receiver_tx_end(aCtx->mReceiver);
 }
 
 /* ----------------------------------------------------- */
@@ -213,6 +250,30 @@ BOOL iohub_light_seamaid_detectPacket(digital_async_receiver_interface_ctx *aCtx
 
 /* ----------------------------------------------------- */
 
+u8 iohub_light_seamaid_getPayload(digital_async_receiver_interface_ctx *aCtx, u8 *aBuffer, u8 aBufferLen)
+{
+	light_seamaid *theCtx = (light_seamaid *)aCtx;
+	u16			theReadIdx = theCtx->mTimingReadIdx;
+	u16			theAddr;
+	u8			theCmd;
+	BOOL		theRet;
+
+	if (aBufferLen < DRV_LIGHT_SEAMAID_PAYLOAD_LEN)
+		return 0;
+
+		//Decode without consuming the frame, the caller still reads it
+	theCtx->mTimingReadIdx = 0;
+	theRet = iohub_light_seamaid_read(theCtx, &theAddr, &theCmd);
+	theCtx->mTimingReadIdx = theReadIdx;
+
+	if (!theRet)
+		return 0;
+
+	return iohub_light_seamaid_pack_payload(aBuffer, theAddr, theCmd);
+}
+
+/* ----------------------------------------------------- */
+
 void iohub_light_seamaid_packetHandled(digital_async_receiver_interface_ctx *aCtx)
 {
 	light_seamaid *theCtx = (light_seamaid *)aCtx;
@@ -228,7 +289,8 @@ const digital_async_receiver_interface  *iohub_light_seamaid_get_interface(void)
 	{
 		DRV_LIGHT_SEAMAID_ID,
 		iohub_light_seamaid_detectPacket,
-		iohub_light_seamaid_packetHandled
+		iohub_light_seamaid_packetHandled,
+		iohub_light_seamaid_getPayload
 	};
 	
 	return &sInterface;
@@ -5,6 +5,8 @@
 #define MISO_PIN				12
 #define SCK_PIN					13
 
+static u8 sSPIRefCount = 0;
+
 /* ------------------------------------------------------------- */
 
 ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
@@ -17,7 +19,8 @@ ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
 	aCtx->mMode = aMode;
 	
 	//SPI.setFrequency(1000000);
-	SPI.begin();
+	if (sSPIRefCount++ == 0) //Bus shared by every device, each one has its own CS
+		SPI.begin();
 
     iohub_digital_set_pin_mode(aCtx->mCSnPin, PinMode_Output);
 	
@@ -30,7 +33,8 @@ ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
 
 void iohub_spi_uninit(spi_ctx *aCtx)
 {
-	SPI.end();
+	if (sSPIRefCount > 0 && --sSPIRefCount == 0)
+		SPI.end();
 }
 
 /* ------------------------------------------------------------- */
@@ -0,0 +1,4 @@
+#include "platform/iohub_platform.h"
+
+/* Spinlock behind iohub_interrupts_disable() / iohub_interrupts_enable() */
+portMUX_TYPE gIohubCriticalMux = portMUX_INITIALIZER_UNLOCKED;
@@ -13,6 +13,13 @@
 #define SPI_HOST_ID				SPI2_HOST
 #define SPI_CLOCK_SPEED_HZ		1000000  /*!< 1 MHz default clock speed */
 
+/* Hexdump of every transfer, very slow: define IOHUB_SPI_TRACE to debug the bus only */
+#ifdef IOHUB_SPI_TRACE
+#	define SPI_TRACE(aTitle, aBuffer, aLen)		do { IOHUB_LOG_DEBUG(aTitle); IOHUB_LOG_BUFFER(aBuffer, aLen); } while(0)
+#else
+#	define SPI_TRACE(aTitle, aBuffer, aLen)		do{}while(0)
+#endif
+
 typedef struct {
     spi_device_handle_t spi_handle;
     spi_bus_config_t bus_config;
@@ -23,6 +30,15 @@ typedef struct {
     IOHubSPIMode mode;
 } esp32_spi_ctx_t;
 
+/*
+    Several devices (e.g. a 433 MHz and an 868 MHz CC1101) share SPI_HOST_ID, each with its own CS.
+    The bus is initialized by the first iohub_spi_init() and freed by the last iohub_spi_uninit().
+    CS is driven by hand, so a device holds the bus from select to deselect (spi_device_acquire_bus):
+    transactions of different devices never interleave, but another device gets the bus back
+    between two transactions, a FIFO drain made of short bursts does not hold it for long.
+*/
+static u8 sBusRefCount = 0;
+
 /* ------------------------------------------------------------- */
 
 ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
@@ -47,14 +63,17 @@ ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
     esp_ctx->bus_config.quadhd_io_num = -1;
     esp_ctx->bus_config.max_transfer_sz = 4092;
 
-    // Initialize SPI bus
-    esp_err_t ret = spi_bus_initialize(SPI_HOST_ID, &esp_ctx->bus_config, SPI_DMA_CH_AUTO);
+    // Initialize SPI bus, once for all the devices
+    esp_err_t ret = ESP_OK;
+    if (sBusRefCount == 0)
+        ret = spi_bus_initialize(SPI_HOST_ID, &esp_ctx->bus_config, SPI_DMA_CH_AUTO);
     if (ret != ESP_OK) {
         IOHUB_LOG_ERROR("Failed to initialize SPI bus: %s", esp_err_to_name(ret));
         free(esp_ctx);
         return E_DEVICE_INIT_FAILED;
     }
     esp_ctx->bus_initialized = TRUE;
+    sBusRefCount++;
 
     // Configure SPI device
     esp_ctx->dev_config.clock_speed_hz = SPI_CLOCK_SPEED_HZ;
@@ -68,7 +87,8 @@ ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
     ret = spi_bus_add_device(SPI_HOST_ID, &esp_ctx->dev_config, &esp_ctx->spi_handle);
     if (ret != ESP_OK) {
         IOHUB_LOG_ERROR("Failed to add SPI device: %s", esp_err_to_name(ret));
-        spi_bus_free(SPI_HOST_ID);
+        if (--sBusRefCount == 0)
+            spi_bus_free(SPI_HOST_ID);
         free(esp_ctx);
         return E_DEVICE_INIT_FAILED;
     }
@@ -102,7 +122,8 @@ void iohub_spi_uninit(spi_ctx *aCtx)
     }
 
     if (esp_ctx->bus_initialized) {
-        spi_bus_free(SPI_HOST_ID);
+        if (--sBusRefCount == 0)
+            spi_bus_free(SPI_HOST_ID);
         esp_ctx->bus_initialized = FALSE;
     }
 
@@ -119,6 +140,10 @@ void iohub_spi_select(spi_ctx *aCtx)
     IOHUB_ASSERT(aCtx->mSelectedCount < 255);
 
     if (aCtx->mSelectedCount++ == 0) {
+        esp32_spi_ctx_t *esp_ctx = (esp32_spi_ctx_t*)aCtx->mCtx;
+
+            // Wait for the other devices to release the bus before driving CS
+        spi_device_acquire_bus(esp_ctx->spi_handle, portMAX_DELAY);
         iohub_digital_write(aCtx->mCSnPin, PinLevel_Low);
         
         if (aCtx->mMode & SPIMode_WaitForMisoLowAfterSelect) {
@@ -134,8 +159,10 @@ void iohub_spi_deselect(spi_ctx *aCtx)
     if (aCtx->mSelectedCount == 0)
         return;
     
-    if (--aCtx->mSelectedCount == 0)
+    if (--aCtx->mSelectedCount == 0) {
         iohub_digital_write(aCtx->mCSnPin, PinLevel_High);
+        spi_device_release_bus(((esp32_spi_ctx_t*)aCtx->mCtx)->spi_handle);
+    }
 }
 
 /* ------------------------------------------------------------- */
@@ -150,8 +177,7 @@ ret_code_t iohub_spi_transfer(spi_ctx *aCtx, u8 *aBuffer, u16 aBufferLen)
 
     iohub_spi_select(aCtx);
     
-    IOHUB_LOG_DEBUG("SPI Tx:");
-    IOHUB_LOG_BUFFER(aBuffer, aBufferLen);
+    SPI_TRACE("SPI Tx:", aBuffer, aBufferLen);
     
     // Prepare SPI transaction
     spi_transaction_t trans;
@@ -167,8 +193,7 @@ ret_code_t iohub_spi_transfer(spi_ctx *aCtx, u8 *aBuffer, u16 aBufferLen)
         return E_WRITE_ERROR;
     }
 
-    IOHUB_LOG_DEBUG("SPI Rx:");
-    IOHUB_LOG_BUFFER(aBuffer, aBufferLen);
+    SPI_TRACE("SPI Rx:", aBuffer, aBufferLen);
     
     iohub_spi_deselect(aCtx);
     return SUCCESS;
@@ -198,8 +223,7 @@ ret_code_t iohub_spi_write(spi_ctx *aCtx, u8 *aBuffer, u16 aBufferLen)
 
     iohub_spi_select(aCtx);
 
-    IOHUB_LOG_DEBUG("SPI Write:");
-    IOHUB_LOG_BUFFER(aBuffer, aBufferLen);
+    SPI_TRACE("SPI Write:", aBuffer, aBufferLen);
     
     // Prepare SPI transaction for write-only
     spi_transaction_t trans;
@@ -252,8 +276,7 @@ ret_code_t iohub_spi_read(spi_ctx *aCtx, u8 *aBuffer, u16 aBufferLen)
         return E_READ_ERROR;
     }
     
-    IOHUB_LOG_DEBUG("SPI Read:");
-    IOHUB_LOG_BUFFER(aBuffer, aBufferLen);
+    SPI_TRACE("SPI Read:", aBuffer, aBufferLen);
     
     iohub_spi_deselect(aCtx);
     return SUCCESS;
@@ -0,0 +1,673 @@
+#include "platform/linux/iohub_cc1101_sim.h"
+#include "utils/iohub_logs.h"
+
+#include <string.h>
+
+	//MARCSTATE values used by the model
+#define SIM_STATE_SLEEP					0x00
+#define SIM_STATE_IDLE					0x01
+#define SIM_STATE_RX					0x0D
+#define SIM_STATE_RXFIFO_OVERFLOW		0x11
+#define SIM_STATE_FSTXON				0x12
+#define SIM_STATE_TX					0x13
+#define SIM_STATE_TXFIFO_UNDERFLOW		0x16
+
+	//Registers / fields the model acts on
+#define SIM_IOCFG2						0x00
+#define SIM_IOCFG0						0x02
+#define SIM_FIFOTHR						0x03
+#define SIM_PKTLEN						0x06
+#define SIM_PKTCTRL1					0x07
+#define SIM_PKTCTRL0					0x08
+#define SIM_ADDR						0x09
+#define SIM_CHANNR						0x0A
+#define SIM_MCSM1						0x17
+#define SIM_MCSM0						0x18
+#define SIM_FSCAL3						0x23
+#define SIM_FSCAL2						0x24
+#define SIM_FSCAL1						0x25
+
+#define SIM_IOCFG_RX_THR_OR_END			0x00
+#define SIM_IOCFG_TX_THR				0x02
+#define SIM_IOCFG_SYNC_END				0x06
+#define SIM_IOCFG_INV					0x40
+#define SIM_PKTCTRL1_APPEND_STATUS		0x04
+#define SIM_PKTCTRL1_CRC_AUTOFLUSH		0x08
+#define SIM_PKTCTRL0_CRC_EN				0x04
+
+#define SIM_HEADER_READ					0x80
+#define SIM_HEADER_BURST				0x40
+#define SIM_ADDR_MASK					0x3F
+#define SIM_ADDR_STROBE_FIRST			0x30
+#define SIM_ADDR_STROBE_LAST			0x3D
+#define SIM_ADDR_PATABLE				0x3E
+#define SIM_ADDR_FIFO					0x3F
+
+	//Datasheet reset values
+static const u8 sResetRegs[CC1101_SIM_REGISTERS_COUNT] =
+{
+	0x29, 0x2E, 0x3F, 0x07, 0xD3, 0x91, 0xFF, 0x04,
+	0x45, 0x00, 0x00, 0x0F, 0x00, 0x1E, 0xC4, 0xEC,
+	0x8C, 0x22, 0x02, 0x22, 0xF8, 0x47, 0x07, 0x30,
+	0x04, 0x36, 0x6C, 0x03, 0x40, 0x91, 0x87, 0x6B,
+	0xF8, 0x56, 0x10, 0xA9, 0x0A, 0x20, 0x0D, 0x41,
+	0x00, 0x59, 0x7F, 0x3F, 0x88, 0x31, 0x0B
+};
+
+static void iohub_cc1101_sim_rx_update(cc1101_sim *aSim);
+
+/* -------------------------------------------------------------- */
+
+	//GDO2 signals the driver streams with, everything else reads low (CHIP_RDYn included)
+static void iohub_cc1101_sim_update_gdo2(cc1101_sim *aSim)
+{
+	u8 	theThreshold = aSim->mRegs[SIM_FIFOTHR] & 0x0F;
+	u8 	theConfig = aSim->mRegs[SIM_IOCFG2];
+	BOOL theLevel = FALSE;
+
+	if (aSim->mGDO2Pin == IOHUB_GPIO_PIN_INVALID)
+		return;
+
+	switch (theConfig & 0x3F)
+	{
+		case SIM_IOCFG_RX_THR_OR_END:
+				//Asserted at the threshold or at the end of the packet, released once the FIFO is empty
+			if (aSim->mRxCount >= 4 * (theThreshold + 1) || (aSim->mRxCount > 0 && !aSim->mfRxInPacket))
+				aSim->mfRxThreshold = TRUE;
+			else if (aSim->mRxCount == 0)
+				aSim->mfRxThreshold = FALSE;
+			theLevel = aSim->mfRxThreshold;
+			break;
+
+		case SIM_IOCFG_TX_THR:
+			theLevel = (aSim->mTxCount >= 61 - 4 * theThreshold) ? TRUE : FALSE;
+			break;
+
+		case SIM_IOCFG_SYNC_END:
+			theLevel = aSim->mfSyncEnd;
+			break;
+
+		default:
+			break;
+	}
+
+	if (theConfig & SIM_IOCFG_INV)
+		theLevel = !theLevel;
+
+	iohub_digital_write(aSim->mGDO2Pin, theLevel ? PinLevel_High : PinLevel_Low);
+}
+
+/* -------------------------------------------------------------- */
+
+	//Sync word sent / received until the end of the packet, on every GDO configured for it
+static void iohub_cc1101_sim_set_gdo0(cc1101_sim *aSim, IOHubPinLevel aLevel)
+{
+	aSim->mfSyncEnd = (aLevel == PinLevel_High) ? TRUE : FALSE;
+
+	if (aSim->mGDO0Pin != IOHUB_GPIO_PIN_INVALID && (aSim->mRegs[SIM_IOCFG0] & 0x3F) == SIM_IOCFG_SYNC_END)
+		iohub_digital_write(aSim->mGDO0Pin, aLevel);
+
+	if ((aSim->mRegs[SIM_IOCFG2] & 0x3F) == SIM_IOCFG_SYNC_END)
+		iohub_cc1101_sim_update_gdo2(aSim);
+}
+
+/* -------------------------------------------------------------- */
+
+static u8 iohub_cc1101_sim_status(cc1101_sim *aSim, BOOL afRead)
+{
+	u8 theState;
+
+	switch (aSim->mState)
+	{
+		case SIM_STATE_RX:					theState = 1; break;
+		case SIM_STATE_TX:					theState = 2; break;
+		case SIM_STATE_FSTXON:				theState = 3; break;
+		case SIM_STATE_RXFIFO_OVERFLOW:		theState = 6; break;
+		case SIM_STATE_TXFIFO_UNDERFLOW:	theState = 7; break;
+		default:							theState = 0; break;
+	}
+
+	u8 theFifo = afRead ? aSim->mRxCount : (u8)(CC1101_SIM_FIFO_SIZE - aSim->mTxCount);
+
+	return (u8)((theState << 4) | (theFifo > 15 ? 15 : theFifo));
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_sim_calibrate(cc1101_sim *aSim)
+{
+	u8 theChannel = aSim->mRegs[SIM_CHANNR];
+
+		//Any value works for the driver, it only has to change with the channel
+	aSim->mRegs[SIM_FSCAL3] = 0xE9;
+	aSim->mRegs[SIM_FSCAL2] = (theChannel >= 0x80) ? 0x0A : 0x2A;
+	aSim->mRegs[SIM_FSCAL1] = (u8)(theChannel & 0x3F);
+
+	aSim->mStats.mCalibrationCount++;
+}
+
+/* -------------------------------------------------------------- */
+
+	//MCSM0.FS_AUTOCAL: 1 = leaving IDLE, 2 = back to IDLE, 3 = every 4th time back to IDLE
+static void iohub_cc1101_sim_autocal(cc1101_sim *aSim, BOOL afLeavingIdle)
+{
+	u8 theAutoCal = (aSim->mRegs[SIM_MCSM0] >> 4) & 0x03;
+
+	if ((afLeavingIdle && theAutoCal == 1) ||
+		(!afLeavingIdle && theAutoCal == 2) ||
+		(!afLeavingIdle && theAutoCal == 3 && (++aSim->mAutoCalCount % 4) == 0))
+	{
+		iohub_cc1101_sim_calibrate(aSim);
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+	//RXOFF_MODE / TXOFF_MODE encoding: IDLE, FSTXON, TX, RX
+static void iohub_cc1101_sim_enter_off_state(cc1101_sim *aSim, u8 aMode)
+{
+	static const u8 sOffStates[4] = { SIM_STATE_IDLE, SIM_STATE_FSTXON, SIM_STATE_TX, SIM_STATE_RX };
+
+	aSim->mState = sOffStates[aMode & 0x03];
+
+	if (aSim->mState == SIM_STATE_IDLE)
+		iohub_cc1101_sim_autocal(aSim, FALSE);
+}
+
+/* -------------------------------------------------------------- */
+
+static BOOL iohub_cc1101_sim_can_receive(cc1101_sim *aSim)
+{
+	return ((aSim->mState == SIM_STATE_RX || aSim->mfWor) && !aSim->mfRxInPacket) ? TRUE : FALSE;
+}
+
+/* -------------------------------------------------------------- */
+
+	//Packet handler checks: address, length and CRC with CRC_AUTOFLUSH
+static BOOL iohub_cc1101_sim_filtered(cc1101_sim *aSim, const u8 *aData, u32 aLength, BOOL afCrcOk)
+{
+	BOOL theVariable = ((aSim->mRegs[SIM_PKTCTRL0] & 0x03) == 1) ? TRUE : FALSE;
+	u32 theAddrPos = theVariable ? 1 : 0;
+
+	if (theVariable && aLength > 0 && aData[0] > aSim->mRegs[SIM_PKTLEN])
+		return TRUE;
+
+	if ((aSim->mRegs[SIM_PKTCTRL1] & 0x03) != 0 && aLength > theAddrPos)
+	{
+		u8 theAddr = aData[theAddrPos];
+		u8 theCheck = aSim->mRegs[SIM_PKTCTRL1] & 0x03;
+
+		if (theAddr != aSim->mRegs[SIM_ADDR] &&
+			!(theCheck >= 2 && theAddr == 0x00) &&
+			!(theCheck == 3 && theAddr == 0xFF))
+			return TRUE;
+	}
+
+	if (!afCrcOk && (aSim->mRegs[SIM_PKTCTRL0] & SIM_PKTCTRL0_CRC_EN) && (aSim->mRegs[SIM_PKTCTRL1] & SIM_PKTCTRL1_CRC_AUTOFLUSH))
+		return TRUE;
+
+	return FALSE;
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_sim_deliver(cc1101_sim *aSim, const u8 *aData, u32 aLength)
+{
+	if (!iohub_cc1101_sim_can_receive(aSim) || aLength > CC1101_SIM_AIR_MAX)
+	{
+		aSim->mStats.mPacketDroppedCount++;
+		return;
+	}
+
+	BOOL theCrcOk = TRUE;
+	if (aSim->mCorruptCount > 0)
+	{
+		aSim->mCorruptCount--;
+		theCrcOk = FALSE;
+	}
+
+		//Discarded by the chip: GDO0 still pulses, nothing reaches the FIFO and the radio keeps listening
+	if (iohub_cc1101_sim_filtered(aSim, aData, aLength, theCrcOk))
+	{
+		aSim->mStats.mPacketFilteredCount++;
+
+		iohub_cc1101_sim_set_gdo0(aSim, PinLevel_High);
+		iohub_cc1101_sim_set_gdo0(aSim, PinLevel_Low);
+		return;
+	}
+
+	memcpy(aSim->mRxAir, aData, aLength);
+	aSim->mRxAirLen = aLength;
+	aSim->mRxAirPos = 0;
+
+	if (aSim->mRegs[SIM_PKTCTRL1] & SIM_PKTCTRL1_APPEND_STATUS)
+	{
+		aSim->mRxAir[aSim->mRxAirLen++] = aSim->mRSSI;
+		aSim->mRxAir[aSim->mRxAirLen++] = (theCrcOk ? 0x80 : 0x00) | (aSim->mLQI & 0x7F);
+	}
+
+	aSim->mfRxInPacket = TRUE;
+	aSim->mfWor = FALSE;
+	aSim->mState = SIM_STATE_RX;
+
+	iohub_cc1101_sim_set_gdo0(aSim, PinLevel_High); //Sync word
+	iohub_cc1101_sim_rx_update(aSim);
+}
+
+/* -------------------------------------------------------------- */
+
+	//Move the packet on air to the RX FIFO, as far as the FIFO allows
+static void iohub_cc1101_sim_rx_update(cc1101_sim *aSim)
+{
+	if (!aSim->mfRxInPacket)
+		return;
+
+	while (aSim->mRxAirPos < aSim->mRxAirLen && aSim->mRxCount < CC1101_SIM_FIFO_SIZE)
+	{
+		aSim->mRxFifo[(aSim->mRxHead + aSim->mRxCount) % CC1101_SIM_FIFO_SIZE] = aSim->mRxAir[aSim->mRxAirPos++];
+		aSim->mRxCount++;
+	}
+
+	if (aSim->mRxAirPos < aSim->mRxAirLen)
+		return;
+
+	aSim->mfRxInPacket = FALSE;
+	aSim->mStats.mPacketReceivedCount++;
+
+	iohub_cc1101_sim_enter_off_state(aSim, (aSim->mRegs[SIM_MCSM1] >> 2) & 0x03);
+	iohub_cc1101_sim_set_gdo0(aSim, PinLevel_Low); //End of packet
+}
+
+/* -------------------------------------------------------------- */
+
+static BOOL iohub_cc1101_sim_tx_complete(cc1101_sim *aSim)
+{
+	switch (aSim->mRegs[SIM_PKTCTRL0] & 0x03)
+	{
+		case 0: //Fixed, also used to end an infinite packet: the byte counter wraps at 256
+			return ((aSim->mTxAirLen & 0xFF) == aSim->mRegs[SIM_PKTLEN]) ? TRUE : FALSE;
+
+		case 1: //Variable
+			return (aSim->mTxAirLen == (u32)aSim->mTxAir[0] + 1) ? TRUE : FALSE;
+
+		default:
+			return FALSE;
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_sim_tx_end(cc1101_sim *aSim)
+{
+	cc1101_sim *theReceiver = (aSim->mPeer != NULL) ? aSim->mPeer : aSim;
+	u32 theLength = aSim->mTxAirLen;
+
+	aSim->mTxAirLen = 0;
+	aSim->mStats.mPacketSentCount++;
+
+	iohub_cc1101_sim_set_gdo0(aSim, PinLevel_Low);
+	iohub_cc1101_sim_enter_off_state(aSim, aSim->mRegs[SIM_MCSM1] & 0x03);
+
+	if (theLength > CC1101_SIM_AIR_MAX)
+		theReceiver->mStats.mPacketDroppedCount++;
+	else
+		iohub_cc1101_sim_deliver(theReceiver, aSim->mTxAir, theLength);
+}
+
+/* -------------------------------------------------------------- */
+
+	//The air is infinitely fast: every byte in the TX FIFO is sent right away
+static void iohub_cc1101_sim_tx_pump(cc1101_sim *aSim)
+{
+	while (aSim->mState == SIM_STATE_TX && aSim->mTxCount > 0)
+	{
+		u8 theByte = aSim->mTxFifo[aSim->mTxHead];
+
+		aSim->mTxHead = (aSim->mTxHead + 1) % CC1101_SIM_FIFO_SIZE;
+		aSim->mTxCount--;
+
+		if (aSim->mTxAirLen == 0)
+			iohub_cc1101_sim_set_gdo0(aSim, PinLevel_High);
+
+		if (aSim->mTxAirLen < CC1101_SIM_AIR_MAX)
+			aSim->mTxAir[aSim->mTxAirLen] = theByte;
+		aSim->mTxAirLen++;
+
+		if (iohub_cc1101_sim_tx_complete(aSim))
+			iohub_cc1101_sim_tx_end(aSim);
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_sim_strobe(cc1101_sim *aSim, u8 aStrobe)
+{
+	if (aStrobe != 0x3D)
+		aSim->mStats.mStrobeCount++;
+
+	switch (aStrobe)
+	{
+		case 0x30: //SRES
+			memcpy(aSim->mRegs, sResetRegs, sizeof(aSim->mRegs));
+			aSim->mState = SIM_STATE_IDLE;
+			aSim->mRxCount = aSim->mTxCount = 0;
+			aSim->mfRxInPacket = aSim->mfWor = FALSE;
+			aSim->mTxAirLen = 0;
+			break;
+
+		case 0x31: //SFSTXON
+			if (aSim->mState == SIM_STATE_IDLE)
+				iohub_cc1101_sim_autocal(aSim, TRUE);
+			aSim->mState = SIM_STATE_FSTXON;
+			break;
+
+		case 0x33: //SCAL
+			if (aSim->mState == SIM_STATE_IDLE)
+				iohub_cc1101_sim_calibrate(aSim);
+			break;
+
+		case 0x34: //SRX
+			if (aSim->mState == SIM_STATE_IDLE)
+				iohub_cc1101_sim_autocal(aSim, TRUE);
+			aSim->mState = SIM_STATE_RX;
+			aSim->mfWor = FALSE;
+			break;
+
+		case 0x35: //STX
+				//Clear channel assessment (MCSM1.CCA_MODE), only evaluated in RX
+			if (aSim->mState == SIM_STATE_RX && (aSim->mRegs[SIM_MCSM1] & 0x30) != 0 && aSim->mCCABusyCount > 0)
+			{
+				aSim->mCCABusyCount--;
+				aSim->mStats.mCCARefusedCount++;
+				break;
+			}
+			if (aSim->mState == SIM_STATE_IDLE)
+				iohub_cc1101_sim_autocal(aSim, TRUE);
+			if (aSim->mState == SIM_STATE_IDLE || aSim->mState == SIM_STATE_RX || aSim->mState == SIM_STATE_FSTXON)
+			{
+				aSim->mState = SIM_STATE_TX;
+				aSim->mTxAirLen = 0;
+				iohub_cc1101_sim_tx_pump(aSim);
+			}
+			break;
+
+		case 0x32: //SXOFF
+		case 0x36: //SIDLE
+			if (aSim->mfRxInPacket)
+				iohub_cc1101_sim_set_gdo0(aSim, PinLevel_Low);
+			aSim->mState = SIM_STATE_IDLE;
+			aSim->mfRxInPacket = aSim->mfWor = FALSE;
+			aSim->mTxAirLen = 0;
+			break;
+
+		case 0x38: //SWOR
+			aSim->mState = SIM_STATE_SLEEP;
+			aSim->mfWor = TRUE;
+			break;
+
+		case 0x39: //SPWD
+			aSim->mfPowerDownPending = TRUE;
+			break;
+
+		case 0x3A: //SFRX
+			aSim->mRxCount = 0;
+			if (aSim->mState == SIM_STATE_RXFIFO_OVERFLOW)
+				aSim->mState = SIM_STATE_IDLE;
+			break;
+
+		case 0x3B: //SFTX
+			aSim->mTxCount = 0;
+			if (aSim->mState == SIM_STATE_TXFIFO_UNDERFLOW)
+				aSim->mState = SIM_STATE_IDLE;
+			break;
+
+		default: //SAFC, SWORRST, SNOP
+			break;
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+static u8 iohub_cc1101_sim_read_status_reg(cc1101_sim *aSim, u8 aAddr)
+{
+	switch (aAddr)
+	{
+		case 0x30: return 0x00;											//PARTNUM
+		case 0x31: return 0x14;											//VERSION
+		case 0x33: return 0x80 | (aSim->mLQI & 0x7F);					//LQI
+		case 0x34: return aSim->mRSSI;									//RSSI
+		case 0x35: return aSim->mState;									//MARCSTATE
+		case 0x38: return 0x80 | (aSim->mfRxInPacket ? 0x08 : 0x00);	//PKTSTATUS
+		case 0x3A: return (u8)((aSim->mState == SIM_STATE_TXFIFO_UNDERFLOW ? 0x80 : 0x00) | aSim->mTxCount);
+		case 0x3B: return (u8)((aSim->mState == SIM_STATE_RXFIFO_OVERFLOW ? 0x80 : 0x00) | aSim->mRxCount);
+		default:   return 0x00;
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+static u8 iohub_cc1101_sim_data(cc1101_sim *aSim, u8 aByte)
+{
+	u8 theOut = iohub_cc1101_sim_status(aSim, aSim->mfRead);
+
+	if (aSim->mAddr == SIM_ADDR_FIFO)
+	{
+		if (aSim->mfRead)
+		{
+			theOut = 0x00;
+			if (aSim->mRxCount > 0)
+			{
+				theOut = aSim->mRxFifo[aSim->mRxHead];
+				aSim->mRxHead = (aSim->mRxHead + 1) % CC1101_SIM_FIFO_SIZE;
+				aSim->mRxCount--;
+			}
+		}
+		else if (aSim->mTxCount < CC1101_SIM_FIFO_SIZE)
+		{
+			aSim->mTxFifo[(aSim->mTxHead + aSim->mTxCount) % CC1101_SIM_FIFO_SIZE] = aByte;
+			aSim->mTxCount++;
+			iohub_cc1101_sim_tx_pump(aSim);
+		}
+		else
+			aSim->mState = SIM_STATE_TXFIFO_UNDERFLOW; //Overflowing the TX FIFO is reported the same way
+	}
+	else if (aSim->mAddr == SIM_ADDR_PATABLE)
+	{
+		if (aSim->mfRead)
+			theOut = aSim->mPaTable[aSim->mPaIndex];
+		else
+			aSim->mPaTable[aSim->mPaIndex] = aByte;
+
+		aSim->mPaIndex = (aSim->mPaIndex + 1) & 0x07;
+	}
+	else if (aSim->mAddr >= SIM_ADDR_STROBE_FIRST)
+	{
+		theOut = iohub_cc1101_sim_read_status_reg(aSim, aSim->mAddr);
+		aSim->mfExpectHeader = TRUE; //Status registers cannot be read in burst
+	}
+	else
+	{
+		if (aSim->mAddr < CC1101_SIM_REGISTERS_COUNT)
+		{
+			if (aSim->mfRead)
+				theOut = aSim->mRegs[aSim->mAddr];
+			else
+				aSim->mRegs[aSim->mAddr] = aByte;
+		}
+
+		aSim->mAddr = (aSim->mAddr + 1) & SIM_ADDR_MASK;
+	}
+
+	if (!aSim->mfBurst)
+		aSim->mfExpectHeader = TRUE;
+
+	return theOut;
+}
+
+/* -------------------------------------------------------------- */
+
+static u8 iohub_cc1101_sim_byte(cc1101_sim *aSim, u8 aByte)
+{
+	if (!aSim->mfExpectHeader)
+		return iohub_cc1101_sim_data(aSim, aByte);
+
+	u8 theAddr = aByte & SIM_ADDR_MASK;
+	u8 theStatus = iohub_cc1101_sim_status(aSim, (aByte & SIM_HEADER_READ) ? TRUE : FALSE);
+
+	if (theAddr >= SIM_ADDR_STROBE_FIRST && theAddr <= SIM_ADDR_STROBE_LAST && !(aByte & SIM_HEADER_BURST))
+	{
+		iohub_cc1101_sim_strobe(aSim, theAddr);
+		return theStatus;
+	}
+
+	aSim->mAddr = theAddr;
+	aSim->mfBurst = (aByte & SIM_HEADER_BURST) ? TRUE : FALSE;
+	aSim->mfRead = (aByte & SIM_HEADER_READ) ? TRUE : FALSE;
+	aSim->mfExpectHeader = FALSE;
+
+	return theStatus;
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_sim_select(void *aDeviceCtx)
+{
+	cc1101_sim *theSim = (cc1101_sim *)aDeviceCtx;
+
+		//CSn low wakes the chip up
+	if (theSim->mState == SIM_STATE_SLEEP)
+	{
+		theSim->mState = SIM_STATE_IDLE;
+		theSim->mfWor = FALSE;
+	}
+
+	theSim->mfExpectHeader = TRUE;
+	iohub_cc1101_sim_rx_update(theSim);
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_sim_deselect(void *aDeviceCtx)
+{
+	cc1101_sim *theSim = (cc1101_sim *)aDeviceCtx;
+
+	theSim->mPaIndex = 0;
+
+	if (theSim->mfPowerDownPending)
+	{
+		theSim->mfPowerDownPending = FALSE;
+		if (theSim->mState == SIM_STATE_IDLE)
+			theSim->mState = SIM_STATE_SLEEP;
+	}
+}
+
+/* -------------------------------------------------------------- */
+
+static void iohub_cc1101_sim_transfer(void *aDeviceCtx, u8 *aBuffer, u16 aBufferLen)
+{
+	cc1101_sim *theSim = (cc1101_sim *)aDeviceCtx;
+
+	for (u16 i=0; i<aBufferLen; i++)
+		aBuffer[i] = iohub_cc1101_sim_byte(theSim, aBuffer[i]);
+
+	iohub_cc1101_sim_rx_update(theSim);
+
+		//FIFO levels moved here, and in the peer when a packet went through
+	iohub_cc1101_sim_update_gdo2(theSim);
+	if (theSim->mPeer != NULL)
+		iohub_cc1101_sim_update_gdo2(theSim->mPeer);
+}
+
+/* -------------------------------------------------------------- */
+
+static const iohub_linux_spi_device sCC1101SimDevice =
+{
+	iohub_cc1101_sim_select,
+	iohub_cc1101_sim_deselect,
+	iohub_cc1101_sim_transfer
+};
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_sim_init(cc1101_sim *aSim, u32 aCSnPin, u32 aGDO0Pin)
+{
+	memset(aSim, 0x00, sizeof(cc1101_sim));
+
+	aSim->mCSnPin = aCSnPin;
+	aSim->mGDO0Pin = aGDO0Pin;
+	aSim->mGDO2Pin = IOHUB_GPIO_PIN_INVALID;
+	aSim->mState = SIM_STATE_SLEEP;
+	aSim->mfExpectHeader = TRUE;
+	aSim->mRSSI = 0x20;		//-58 dBm
+	aSim->mLQI = 0x10;
+	memcpy(aSim->mRegs, sResetRegs, sizeof(aSim->mRegs));
+
+	return iohub_linux_spi_attach(aCSnPin, &sCC1101SimDevice, aSim);
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_sim_uninit(cc1101_sim *aSim)
+{
+	iohub_cc1101_sim_connect(aSim, NULL);
+	iohub_linux_spi_detach(aSim->mCSnPin);
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_sim_connect(cc1101_sim *aSim, cc1101_sim *aPeer)
+{
+	if (aSim->mPeer != NULL)
+		aSim->mPeer->mPeer = NULL;
+
+	aSim->mPeer = aPeer;
+
+	if (aPeer != NULL)
+		aPeer->mPeer = aSim;
+}
+
+/* -------------------------------------------------------------- */
+
+ret_code_t iohub_cc1101_sim_inject(cc1101_sim *aSim, const u8 *aData, u32 aLength)
+{
+	if (aLength > CC1101_SIM_AIR_MAX)
+		return E_INVALID_PARAMETERS;
+
+	if (!iohub_cc1101_sim_can_receive(aSim))
+		return E_INVALID_STATE;
+
+	iohub_cc1101_sim_deliver(aSim, aData, aLength);
+	iohub_cc1101_sim_update_gdo2(aSim);
+
+	return SUCCESS;
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_sim_set_link(cc1101_sim *aSim, u8 aRSSI, u8 aLQI)
+{
+	aSim->mRSSI = aRSSI;
+	aSim->mLQI = aLQI;
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_sim_set_channel_busy(cc1101_sim *aSim, u8 aRefusals)
+{
+	aSim->mCCABusyCount = aRefusals;
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_sim_corrupt(cc1101_sim *aSim, u8 aCount)
+{
+	aSim->mCorruptCount = aCount;
+}
+
+/* -------------------------------------------------------------- */
+
+void iohub_cc1101_sim_set_gdo2_pin(cc1101_sim *aSim, u32 aGDO2Pin)
+{
+	aSim->mGDO2Pin = aGDO2Pin;
+	iohub_cc1101_sim_update_gdo2(aSim);
+}
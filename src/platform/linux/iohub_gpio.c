@@ -0,0 +1,89 @@
+#include "platform/iohub_platform.h"
+#include "utils/iohub_logs.h"
+
+/*
+	Virtual GPIO bank for the Linux host platform.
+	Pins only exist in memory, writing an edge calls the handler attached to the same pin.
+*/
+
+typedef struct linux_gpio_pin_s
+{
+	IOHubPinMode		mMode;
+	IOHubPinLevel		mLevel;
+	gpio_isr_t			mISR;
+	gpio_int_type_t		mIntType;
+	void				*mISRArg;
+}linux_gpio_pin;
+
+static linux_gpio_pin	sPins[IOHUB_LINUX_GPIO_COUNT];
+
+/* ------------------------------------------------------------- */
+
+void iohub_linux_gpio_set_pin_mode(u32 aPin, IOHubPinMode aPinMode)
+{
+	if (aPin >= IOHUB_LINUX_GPIO_COUNT)
+		return;
+
+	sPins[aPin].mMode = aPinMode;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_linux_gpio_write(u32 aPin, IOHubPinLevel aPinLevel)
+{
+	if (aPin >= IOHUB_LINUX_GPIO_COUNT)
+		return;
+
+	linux_gpio_pin *thePin = &sPins[aPin];
+	if (thePin->mLevel == aPinLevel)
+		return;
+
+	thePin->mLevel = aPinLevel;
+
+	if (thePin->mISR == NULL)
+		return;
+
+	if (thePin->mIntType == GPIOIntType_Change ||
+		(thePin->mIntType == GPIOIntType_Rising && aPinLevel == PinLevel_High) ||
+		(thePin->mIntType == GPIOIntType_Falling && aPinLevel == PinLevel_Low))
+	{
+		thePin->mISR(thePin->mISRArg);
+	}
+}
+
+/* ------------------------------------------------------------- */
+
+IOHubPinLevel iohub_linux_gpio_read(u32 aPin)
+{
+	if (aPin >= IOHUB_LINUX_GPIO_COUNT)
+		return PinLevel_Low;
+
+	return sPins[aPin].mLevel;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_attach_interrupt(gpio_num_t pin, gpio_isr_t isr_handler, gpio_int_type_t intr_type, void* arg)
+{
+	if (pin >= IOHUB_LINUX_GPIO_COUNT)
+		return E_INVALID_PARAMETERS;
+
+	sPins[pin].mISR = isr_handler;
+	sPins[pin].mIntType = intr_type;
+	sPins[pin].mISRArg = arg;
+
+	return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_detach_interrupt(u8 pin)
+{
+	if (pin >= IOHUB_LINUX_GPIO_COUNT)
+		return E_INVALID_PARAMETERS;
+
+	sPins[pin].mISR = NULL;
+	sPins[pin].mISRArg = NULL;
+
+	return SUCCESS;
+}
@@ -0,0 +1,45 @@
+#include "platform/iohub_i2c.h"
+#include <memory.h>
+#include <stdlib.h>
+
+/*
+	There is no I2C bus on the Linux host platform, every access fails with E_NOT_SUPPORTED.
+*/
+
+/* --------------------------------------------------------- */
+
+int iohub_i2c_init(i2c_ctx *aCtx, u8 aI2CDeviceAddr)
+{
+    memset(aCtx, 0x00, sizeof(i2c_ctx));
+
+    aCtx->mI2CDeviceAddr = aI2CDeviceAddr;
+    
+    return SUCCESS;
+}
+
+/* --------------------------------------------------------- */
+
+void iohub_i2c_uninit(i2c_ctx *aCtx)
+{   
+}
+
+/* --------------------------------------------------------- */
+
+ret_code_t iohub_i2c_request_read(i2c_ctx *aCtx, BOOL afIssueStop)
+{
+    return E_NOT_SUPPORTED;
+}
+
+/* --------------------------------------------------------- */
+
+ret_code_t iohub_i2c_read(i2c_ctx *aCtx, u8 *aBuffer, const u16 aLen)
+{
+    return E_NOT_SUPPORTED;
+}
+
+/* --------------------------------------------------------- */
+
+ret_code_t iohub_i2c_write(i2c_ctx *aCtx, const u8 *aBuffer, const u16 aLen, BOOL afIssueStop)
+{
+    return E_NOT_SUPPORTED;
+}
@@ -0,0 +1,184 @@
+#include "platform/iohub_spi.h"
+#include "platform/iohub_platform.h"
+#include "utils/iohub_logs.h"
+
+/*
+	There is no SPI bus on the Linux host platform.
+	Chip select is driven on the virtual GPIO bank, transfers go to the model attached to the
+	chip select pin with iohub_linux_spi_attach() and fail with E_NOT_SUPPORTED without one.
+*/
+
+typedef struct linux_spi_slot_s
+{
+	BOOL							mfUsed;
+	u32								mCSnPin;
+	const iohub_linux_spi_device	*mDevice;
+	void							*mDeviceCtx;
+	iohub_linux_spi_stats			mStats;
+}linux_spi_slot;
+
+static linux_spi_slot	sSlots[IOHUB_LINUX_SPI_DEVICE_COUNT];
+
+/* ------------------------------------------------------------- */
+
+static linux_spi_slot *iohub_linux_spi_find(u32 aCSnPin)
+{
+	for (u8 i=0; i<IOHUB_LINUX_SPI_DEVICE_COUNT; i++)
+	{
+		if (sSlots[i].mfUsed && sSlots[i].mCSnPin == aCSnPin)
+			return &sSlots[i];
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_linux_spi_attach(u32 aCSnPin, const iohub_linux_spi_device *aDevice, void *aDeviceCtx)
+{
+	linux_spi_slot *theSlot = iohub_linux_spi_find(aCSnPin);
+
+	for (u8 i=0; i<IOHUB_LINUX_SPI_DEVICE_COUNT && theSlot == NULL; i++)
+	{
+		if (!sSlots[i].mfUsed)
+			theSlot = &sSlots[i];
+	}
+
+	if (theSlot == NULL)
+		return E_INVALID_STATE;
+
+	memset(theSlot, 0x00, sizeof(linux_spi_slot));
+	theSlot->mfUsed = TRUE;
+	theSlot->mCSnPin = aCSnPin;
+	theSlot->mDevice = aDevice;
+	theSlot->mDeviceCtx = aDeviceCtx;
+
+	return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_linux_spi_detach(u32 aCSnPin)
+{
+	linux_spi_slot *theSlot = iohub_linux_spi_find(aCSnPin);
+
+	if (theSlot != NULL)
+		theSlot->mfUsed = FALSE;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_linux_spi_get_stats(u32 aCSnPin, iohub_linux_spi_stats *aStats)
+{
+	linux_spi_slot *theSlot = iohub_linux_spi_find(aCSnPin);
+
+	if (theSlot == NULL)
+		return E_DEVICE_NOT_FOUND;
+
+	memcpy(aStats, &theSlot->mStats, sizeof(iohub_linux_spi_stats));
+
+	return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_linux_spi_reset_stats(u32 aCSnPin)
+{
+	linux_spi_slot *theSlot = iohub_linux_spi_find(aCSnPin);
+
+	if (theSlot != NULL)
+		memset(&theSlot->mStats, 0x00, sizeof(iohub_linux_spi_stats));
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
+{
+    memset(aCtx, 0x00, sizeof(spi_ctx));
+
+	aCtx->mCSnPin = aCSnPin;
+	aCtx->mMode = aMode;
+
+    iohub_digital_set_pin_mode(aCtx->mCSnPin, PinMode_Output);
+	iohub_digital_write(aCtx->mCSnPin, PinLevel_High); //Deselect
+
+    return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_spi_uninit(spi_ctx *aCtx)
+{
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_spi_select(spi_ctx *aCtx)
+{
+    IOHUB_ASSERT(aCtx->mSelectedCount < 255);
+
+    if ( aCtx->mSelectedCount++ == 0 )
+	{
+        iohub_digital_write(aCtx->mCSnPin, PinLevel_Low);
+
+		linux_spi_slot *theSlot = iohub_linux_spi_find(aCtx->mCSnPin);
+		if (theSlot != NULL)
+		{
+			theSlot->mStats.mTransactionCount++;
+			theSlot->mStats.mCSToggleCount++;
+
+			if (theSlot->mDevice->mSelect != NULL)
+				theSlot->mDevice->mSelect(theSlot->mDeviceCtx);
+		}
+	}
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_spi_deselect(spi_ctx *aCtx)
+{
+    if ( aCtx->mSelectedCount == 0 )
+		return;
+	
+    if ( --aCtx->mSelectedCount == 0 )
+	{
+        iohub_digital_write(aCtx->mCSnPin, PinLevel_High);
+
+		linux_spi_slot *theSlot = iohub_linux_spi_find(aCtx->mCSnPin);
+		if (theSlot != NULL)
+		{
+			theSlot->mStats.mCSToggleCount++;
+
+			if (theSlot->mDevice->mDeselect != NULL)
+				theSlot->mDevice->mDeselect(theSlot->mDeviceCtx);
+		}
+	}
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_spi_transfer(spi_ctx *aCtx, u8 *aBuffer, u16 aBufferLen)
+{
+	linux_spi_slot *theSlot = iohub_linux_spi_find(aCtx->mCSnPin);
+
+	if (theSlot == NULL || theSlot->mDevice->mTransfer == NULL)
+	    return E_NOT_SUPPORTED;
+
+	theSlot->mStats.mTransferCount++;
+	theSlot->mStats.mByteCount += aBufferLen;
+
+	theSlot->mDevice->mTransfer(theSlot->mDeviceCtx, aBuffer, aBufferLen);
+
+	return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+u8 iohub_spi_transfer_byte(spi_ctx *aCtx, u8 aByte)
+{
+    u8 theByte = aByte;
+    if (iohub_spi_transfer(aCtx, &theByte, sizeof(theByte)) == SUCCESS)
+        return theByte;
+
+    return 0x00;
+}
@@ -0,0 +1,24 @@
+#include "platform/iohub_platform.h"
+
+/*
+	Virtual clock for the Linux host platform, see iohub_linux_time_set_virtual().
+*/
+
+BOOL			gIohubLinuxVirtualClock = FALSE;
+uint64_t		gIohubLinuxVirtualTimeUs = 0;
+
+/* ------------------------------------------------------------- */
+
+void iohub_linux_time_set_virtual(BOOL afEnable)
+{
+	if (afEnable && !gIohubLinuxVirtualClock)
+	{
+		struct timespec ts;
+
+			//Start from the real time so durations stay consistent across the switch
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		gIohubLinuxVirtualTimeUs = (uint64_t)ts.tv_sec * 1000000ULL + (ts.tv_nsec / 1000ULL);
+	}
+
+	gIohubLinuxVirtualClock = afEnable;
+}
@@ -0,0 +1,57 @@
+#include "platform/iohub_uart.h"
+#include <memory.h>
+
+/*
+	There is no UART on the Linux host platform, every access fails with E_NOT_SUPPORTED.
+*/
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_uart_init(uart_ctx *ctx, u8 txPin, u8 rxPin)
+{
+    memset(ctx, 0x00, sizeof(uart_ctx));
+
+    return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_uart_open(uart_ctx *ctx, u32 baudrate, IOHubUartParity parity, u8 stopBits)
+{
+    return E_NOT_SUPPORTED;
+}
+
+/* ------------------------------------------------------------- */
+
+u16 iohub_uart_data_available(uart_ctx *ctx)
+{
+    return 0;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_uart_read_byte(uart_ctx *ctx, u8 *byte)
+{
+    return E_NOT_SUPPORTED;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_uart_read(uart_ctx *ctx, u8 *buffer, u16 *size)
+{
+    *size = 0;
+    return E_NOT_SUPPORTED;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_uart_write(uart_ctx *ctx, const u8 *buffer, u16 size)
+{
+    return E_NOT_SUPPORTED;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_uart_close(uart_ctx *ctx)
+{
+}
@@ -0,0 +1,332 @@
+#include "platform/iohub_platform.h"
+#include "utils/iohub_logs.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	Waveform compiler / player for the FTDI MPSSE platform.
+
+	Samples are 1 byte = the ADBUS levels for one tick of the measured bitbang sample rate.
+	Streaming uses asynchronous bitbang: samples are still clocked out at the fixed baudrate clock,
+	but unlike synchronous bitbang the chip does not stall when nobody reads back the input
+	samples, which would stretch the pulse in progress at every USB chunk boundary.
+*/
+#define MPSSE_WAVEFORM_GROW_SAMPLES			(64 * 1024)
+#define MPSSE_WAVEFORM_CHUNK_SIZE			(64 * 1024)
+
+	//libmpsse GPIOL0-3 are ADBUS4-7
+#define MPSSE_WAVEFORM_GPIOL_COUNT			4
+#define MPSSE_WAVEFORM_GPIOL_SHIFT			4
+
+	//Rate measurement: a priming write fills the chip FIFO, then N and 2N samples are timed. Both
+	//writes start and end with a full FIFO, their duration difference is N samples of playback
+#define MPSSE_WAVEFORM_MEASURE_SAMPLES		(32 * 1024)
+	//Measured rate error accepted without correcting the baudrate
+#define MPSSE_WAVEFORM_RATE_TOLERANCE_PCT	1
+
+static int	sMPSSEWaveformBaudrate = IOHUB_MPSSE_WAVEFORM_BAUDRATE;
+static u32	sMPSSEWaveformRateHz = 0;
+
+/* ------------------------------------------------------------- */
+
+void iohub_fast_gpio_init(iohub_fast_gpio *aGPIO, u32 aPin)
+{
+	memset(aGPIO, 0x00, sizeof(iohub_fast_gpio));
+	aGPIO->mPin = aPin;
+
+	if (aPin < MPSSE_WAVEFORM_GPIOL_COUNT)
+		aGPIO->mMask = (u8)(1 << (aPin + MPSSE_WAVEFORM_GPIOL_SHIFT));
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_fast_gpio_uninit(iohub_fast_gpio *aGPIO)
+{
+		//Only left allocated when a waveform was begun and never ended
+	free(aGPIO->mSamples);
+	aGPIO->mSamples = NULL;
+	aGPIO->mSampleCount = 0;
+	aGPIO->mSampleMax = 0;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_fast_gpio_set(iohub_fast_gpio *aGPIO)
+{
+	if (aGPIO->mfWaveform)
+		aGPIO->mLevel = 1;
+	else
+		PinHigh(gMPSSECtx, aGPIO->mPin);
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_fast_gpio_clear(iohub_fast_gpio *aGPIO)
+{
+	if (aGPIO->mfWaveform)
+		aGPIO->mLevel = 0;
+	else
+		PinLow(gMPSSECtx, aGPIO->mPin);
+}
+
+/* ------------------------------------------------------------- */
+
+static BOOL iohub_mpsse_waveform_reserve(iohub_fast_gpio *aGPIO, u32 aSampleCount)
+{
+	if (aGPIO->mSampleCount + aSampleCount <= aGPIO->mSampleMax)
+		return TRUE;
+
+	u32 theNewMax = aGPIO->mSampleCount + aSampleCount + MPSSE_WAVEFORM_GROW_SAMPLES;
+	if (theNewMax > IOHUB_MPSSE_WAVEFORM_MAX_SAMPLES)
+		return FALSE;
+
+	u8 *theSamples = (u8 *)realloc(aGPIO->mSamples, theNewMax);
+	if (theSamples == NULL)
+		return FALSE;
+
+	aGPIO->mSamples = theSamples;
+	aGPIO->mSampleMax = theNewMax;
+	return TRUE;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_fast_gpio_delay_us(iohub_fast_gpio *aGPIO, u32 aDelayUs)
+{
+	if (!aGPIO->mfWaveform)
+	{
+		iohub_time_delay_us(aDelayUs);
+		return;
+	}
+
+	if (aGPIO->mfOverflow)
+		return;
+
+	u32 theSampleCount = (u32)(((uint64_t)aDelayUs * sMPSSEWaveformRateHz + 500000) / 1000000);
+
+	if (!iohub_mpsse_waveform_reserve(aGPIO, theSampleCount))
+	{
+		aGPIO->mfOverflow = TRUE;
+		return;
+	}
+
+	memset(&aGPIO->mSamples[aGPIO->mSampleCount], aGPIO->mIdleSample | (aGPIO->mLevel ? aGPIO->mMask : 0x00), theSampleCount);
+	aGPIO->mSampleCount += theSampleCount;
+}
+
+/* ------------------------------------------------------------- */
+
+static ret_code_t iohub_mpsse_bitbang_enter(struct ftdi_context *aFTDI, u8 aDirection, int aBaudrate)
+{
+	if (ftdi_set_bitmode(aFTDI, aDirection, BITMODE_BITBANG) < 0 ||
+		ftdi_set_baudrate(aFTDI, aBaudrate) < 0)
+	{
+		IOHUB_LOG_ERROR("MPSSE waveform: cannot enter bitbang mode (%s)", ftdi_get_error_string(aFTDI));
+		return E_DEVICE_INIT_FAILED;
+	}
+
+		//One bulk write, libftdi only splits it at the chunk size
+	ftdi_write_data_set_chunksize(aFTDI, MPSSE_WAVEFORM_CHUNK_SIZE);
+	return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+static void iohub_mpsse_bitbang_leave(struct ftdi_context *aFTDI)
+{
+		//Back to MPSSE so SPI / I2C / GPIO keep working
+	ftdi_set_bitmode(aFTDI, 0, BITMODE_RESET);
+	ftdi_set_bitmode(aFTDI, 0, BITMODE_MPSSE);
+	SetMode(gMPSSECtx, gMPSSECtx->endianess);
+	SetClock(gMPSSECtx, gMPSSECtx->clock);
+}
+
+/* ------------------------------------------------------------- */
+
+static ret_code_t iohub_mpsse_waveform_measure(struct ftdi_context *aFTDI, u8 *aSamples, u32 *aRateHz)
+{
+	uint64_t	theStart;
+	uint64_t	theShortUs;
+	uint64_t	theLongUs;
+
+	if (ftdi_write_data(aFTDI, aSamples, MPSSE_WAVEFORM_MEASURE_SAMPLES) != MPSSE_WAVEFORM_MEASURE_SAMPLES)
+		return E_WRITE_ERROR;
+
+	theStart = iohub_time_now_us();
+	if (ftdi_write_data(aFTDI, aSamples, MPSSE_WAVEFORM_MEASURE_SAMPLES) != MPSSE_WAVEFORM_MEASURE_SAMPLES)
+		return E_WRITE_ERROR;
+	theShortUs = iohub_time_now_us() - theStart;
+
+	theStart = iohub_time_now_us();
+	if (ftdi_write_data(aFTDI, aSamples, 2 * MPSSE_WAVEFORM_MEASURE_SAMPLES) != 2 * MPSSE_WAVEFORM_MEASURE_SAMPLES)
+		return E_WRITE_ERROR;
+	theLongUs = iohub_time_now_us() - theStart;
+
+	if (theLongUs <= theShortUs)
+		return E_INVALID_DATA;
+
+	*aRateHz = (u32)(((uint64_t)MPSSE_WAVEFORM_MEASURE_SAMPLES * 1000000) / (theLongUs - theShortUs));
+	return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+static BOOL iohub_mpsse_waveform_rate_ok(u32 aRateHz)
+{
+	uint64_t theTarget = IOHUB_MPSSE_WAVEFORM_SAMPLE_RATE_HZ;
+
+	return ((uint64_t)aRateHz * 100 >= theTarget * (100 - MPSSE_WAVEFORM_RATE_TOLERANCE_PCT) &&
+			(uint64_t)aRateHz * 100 <= theTarget * (100 + MPSSE_WAVEFORM_RATE_TOLERANCE_PCT));
+}
+
+/* ------------------------------------------------------------- */
+
+	//Plays a constant sample (pins stay where they are) to measure the rate the baudrate really gives
+static ret_code_t iohub_mpsse_waveform_calibrate(u8 aSample, u8 aDirection)
+{
+	struct ftdi_context *theFTDI = &gMPSSECtx->ftdi;
+	u32 				theRateHz = 0;
+	int 				theBaudrate = sMPSSEWaveformBaudrate;
+	ret_code_t 			theRet;
+	u8 					*theSamples;
+
+	theSamples = (u8 *)malloc(2 * MPSSE_WAVEFORM_MEASURE_SAMPLES);
+	if (theSamples == NULL)
+		return E_DEVICE_INIT_FAILED;
+	memset(theSamples, aSample, 2 * MPSSE_WAVEFORM_MEASURE_SAMPLES);
+
+	theRet = iohub_mpsse_bitbang_enter(theFTDI, aDirection, theBaudrate);
+	if (theRet == SUCCESS)
+		theRet = iohub_mpsse_waveform_measure(theFTDI, theSamples, &theRateHz);
+
+		//Scale the baudrate once, the divider granularity is absorbed by compiling with the measured rate
+	if (theRet == SUCCESS && !iohub_mpsse_waveform_rate_ok(theRateHz))
+	{
+		theBaudrate = (int)(((uint64_t)theBaudrate * IOHUB_MPSSE_WAVEFORM_SAMPLE_RATE_HZ + theRateHz / 2) / theRateHz);
+
+		theRet = iohub_mpsse_bitbang_enter(theFTDI, aDirection, theBaudrate);
+		if (theRet == SUCCESS)
+			theRet = iohub_mpsse_waveform_measure(theFTDI, theSamples, &theRateHz);
+	}
+
+	iohub_mpsse_bitbang_leave(theFTDI);
+	free(theSamples);
+
+	if (theRet != SUCCESS)
+	{
+		IOHUB_LOG_ERROR("MPSSE waveform: sample rate measurement failed (%d)", theRet);
+		return theRet;
+	}
+
+	IOHUB_LOG_INFO("MPSSE waveform: baudrate %d gives %lu samples/s (%u expected)", theBaudrate, theRateHz, IOHUB_MPSSE_WAVEFORM_SAMPLE_RATE_HZ);
+
+	sMPSSEWaveformBaudrate = theBaudrate;
+	sMPSSEWaveformRateHz = theRateHz;
+	return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+u32 iohub_fast_gpio_waveform_rate_hz(void)
+{
+	return sMPSSEWaveformRateHz;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_fast_gpio_waveform_begin(iohub_fast_gpio *aGPIO)
+{
+	u8 			thePins;
+	ret_code_t 	theRet;
+
+	if (aGPIO->mfWaveform)
+		return E_INVALID_STATE;
+
+	if (gMPSSECtx == NULL || !gMPSSECtx->open)
+		return E_DEVICE_NOT_FOUND;
+
+		//GPIOH (ACBUS): stay on the PinHigh() / PinLow() path
+	if (aGPIO->mMask == 0)
+	{
+		IOHUB_LOG_DEBUG("MPSSE waveform: pin %lu is not on ADBUS, sent without streaming", aGPIO->mPin);
+		return E_NOT_SUPPORTED;
+	}
+
+		//Bitbang drives every pin of its direction mask from each sample: keep the other outputs where they are
+	if (ftdi_read_pins(&gMPSSECtx->ftdi, &thePins) < 0)
+		thePins = gMPSSECtx->pidle;
+
+	aGPIO->mDirection = gMPSSECtx->tris | aGPIO->mMask;
+	aGPIO->mIdleSample = thePins & gMPSSECtx->tris & (u8)~aGPIO->mMask;
+
+	if (sMPSSEWaveformRateHz == 0)
+	{
+		theRet = iohub_mpsse_waveform_calibrate(thePins & aGPIO->mDirection, aGPIO->mDirection);
+		if (theRet != SUCCESS)
+			return theRet;
+	}
+
+	aGPIO->mfWaveform = TRUE;
+	aGPIO->mfOverflow = FALSE;
+	aGPIO->mSampleCount = 0;
+	aGPIO->mLevel = 0;
+
+	return SUCCESS;
+}
+
+/* ------------------------------------------------------------- */
+
+static ret_code_t iohub_mpsse_waveform_stream(iohub_fast_gpio *aGPIO)
+{
+	struct ftdi_context *theFTDI = &gMPSSECtx->ftdi;
+	ret_code_t 			theRet;
+
+	theRet = iohub_mpsse_bitbang_enter(theFTDI, aGPIO->mDirection, sMPSSEWaveformBaudrate);
+	if (theRet == SUCCESS &&
+		ftdi_write_data(theFTDI, aGPIO->mSamples, (int)aGPIO->mSampleCount) != (int)aGPIO->mSampleCount)
+	{
+		IOHUB_LOG_ERROR("MPSSE waveform: write failed (%s)", ftdi_get_error_string(theFTDI));
+		theRet = E_WRITE_ERROR;
+	}
+
+	iohub_mpsse_bitbang_leave(theFTDI);
+
+	return theRet;
+}
+
+/* ------------------------------------------------------------- */
+
+ret_code_t iohub_fast_gpio_waveform_end(iohub_fast_gpio *aGPIO)
+{
+	ret_code_t theRet;
+
+	if (!aGPIO->mfWaveform)
+		return E_INVALID_STATE;
+
+	aGPIO->mfWaveform = FALSE;
+
+		//Last sample is held by the chip once the buffer is drained, make it the final level
+	if (!aGPIO->mfOverflow && iohub_mpsse_waveform_reserve(aGPIO, 1))
+		aGPIO->mSamples[aGPIO->mSampleCount++] = aGPIO->mIdleSample | (aGPIO->mLevel ? aGPIO->mMask : 0x00);
+	else
+		aGPIO->mfOverflow = TRUE;
+
+	if (aGPIO->mfOverflow)
+	{
+		IOHUB_LOG_ERROR("MPSSE waveform: more than %u samples", IOHUB_MPSSE_WAVEFORM_MAX_SAMPLES);
+		theRet = E_INVALID_DATA;
+	}
+	else
+	{
+		IOHUB_LOG_DEBUG("MPSSE waveform: %u samples (%u us)", aGPIO->mSampleCount,
+					(u32)(((uint64_t)aGPIO->mSampleCount * 1000000) / sMPSSEWaveformRateHz));
+		theRet = iohub_mpsse_waveform_stream(aGPIO);
+	}
+
+	free(aGPIO->mSamples);
+	aGPIO->mSamples = NULL;
+	aGPIO->mSampleCount = 0;
+	aGPIO->mSampleMax = 0;
+
+	return theRet;
+}
@@ -16,6 +16,8 @@ CSn - D4 - D7
 
 extern struct mpsse_context *sMPSSECtx;
 
+static u8 sSPIRefCount = 0; //Devices sharing the FTDI SPI bus, closed with the last one
+
 /* ------------------------------------------------------------- */
 
 ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
@@ -37,6 +39,7 @@ ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
     }
 
     IOHUB_ASSERT(sMPSSECtx->mode == SPI0);
+    sSPIRefCount++;
 
     theRet = iohub_digital_set_pin_mode(aCtx->mCSnPin, PinMode_Output);;
     if (theRet == SUCCESS)
@@ -49,7 +52,11 @@ ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
 
 void iohub_spi_uninit(spi_ctx *aCtx)
 {
-    Close(sMPSSECtx);
+    if (sSPIRefCount > 0 && --sSPIRefCount == 0)
+    {
+        Close(sMPSSECtx);
+        sMPSSECtx = NULL;
+    }
 }
 
 /* ------------------------------------------------------------- */
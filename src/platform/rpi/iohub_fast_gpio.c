@@ -0,0 +1,174 @@
+#include "platform/iohub_platform.h"
+#include "utils/iohub_logs.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+/*
+	BCM283x / BCM2711 GPIO registers (/dev/gpiomem maps the GPIO block at offset 0)
+		GPSET0 0x1C, GPSET1 0x20
+		GPCLR0 0x28, GPCLR1 0x2C
+	Other SoCs may still expose a /dev/gpiomem (Pi 5: BCM2712 + RP1) with a different layout,
+	the device tree compatible list must name one of the SoCs above before mapping it.
+*/
+#define GPIOMEM_DEV				"/dev/gpiomem"
+#define DT_COMPATIBLE			"/proc/device-tree/compatible"
+#define DT_COMPATIBLE_SIZE		256
+#define GPIOMEM_SIZE			4096
+
+#define GPIO_REG_GPSET0			(0x1C / 4)
+#define GPIO_REG_GPCLR0			(0x28 / 4)
+
+#define GPIO_BCM_COUNT			54
+
+static volatile uint32_t 		*sGPIOMap = NULL;
+static BOOL						sfGPIOMapTried = FALSE;
+
+static const char * const		sGPIOMemSoCs[] = { "brcm,bcm2835", "brcm,bcm2836", "brcm,bcm2837", "brcm,bcm2711" };
+
+/* ------------------------------------------------------------- */
+
+static BOOL iohub_rpi_soc_has_bcm_gpio(void)
+{
+	char 	theCompatible[DT_COMPATIBLE_SIZE];
+	ssize_t	theSize;
+
+	int theFd = open(DT_COMPATIBLE, O_RDONLY);
+	if (theFd < 0)
+		return FALSE;
+
+	theSize = read(theFd, theCompatible, sizeof(theCompatible) - 1);
+	close(theFd);
+
+	if (theSize <= 0)
+		return FALSE;
+	theCompatible[theSize] = '\0';
+
+		//NUL separated list, i.e. "raspberrypi,4-model-b\0brcm,bcm2711\0"
+	for (ssize_t theOffset = 0; theOffset < theSize; theOffset += strlen(&theCompatible[theOffset]) + 1)
+	{
+		for (size_t i = 0; i < sizeof(sGPIOMemSoCs) / sizeof(sGPIOMemSoCs[0]); ++i)
+		{
+			if (strcmp(&theCompatible[theOffset], sGPIOMemSoCs[i]) == 0)
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* ------------------------------------------------------------- */
+
+static volatile uint32_t *iohub_rpi_gpiomem_map(void)
+{
+	if (sfGPIOMapTried)
+		return sGPIOMap;
+
+	sfGPIOMapTried = TRUE;
+
+	if (!iohub_rpi_soc_has_bcm_gpio())
+	{
+		IOHUB_LOG_INFO("Fast GPIO: SoC without BCM283x GPIO registers, using the GPIO chardev");
+		return NULL;
+	}
+
+	int theFd = open(GPIOMEM_DEV, O_RDWR | O_SYNC);
+	if (theFd < 0)
+	{
+		IOHUB_LOG_WARNING("Fast GPIO: cannot open %s", GPIOMEM_DEV);
+		return NULL;
+	}
+
+	void *theMap = mmap(NULL, GPIOMEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, theFd, 0);
+	close(theFd); //Mapping stays valid
+
+	if (theMap == MAP_FAILED)
+	{
+		IOHUB_LOG_WARNING("Fast GPIO: cannot map %s", GPIOMEM_DEV);
+		return NULL;
+	}
+
+	sGPIOMap = (volatile uint32_t *)theMap;
+	return sGPIOMap;
+}
+
+/* ------------------------------------------------------------- */
+
+static int iohub_rpi_chardev_request(int aBCMPin)
+{
+	struct gpio_v2_line_request theRequest;
+
+	int theChipFd = open(IOHUB_RPI_GPIOCHIP_DEV, O_RDWR);
+	if (theChipFd < 0)
+		return -1;
+
+	memset(&theRequest, 0x00, sizeof(theRequest));
+	theRequest.offsets[0] = aBCMPin;
+	theRequest.num_lines = 1;
+	theRequest.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+	strncpy(theRequest.consumer, "iohub", sizeof(theRequest.consumer) - 1);
+
+	int theRet = ioctl(theChipFd, GPIO_V2_GET_LINE_IOCTL, &theRequest);
+	close(theChipFd);
+
+	return (theRet < 0) ? -1 : theRequest.fd;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_fast_gpio_init(iohub_fast_gpio *aGPIO, uint32_t aPin)
+{
+	memset(aGPIO, 0x00, sizeof(iohub_fast_gpio));
+	aGPIO->mPin = aPin;
+	aGPIO->mLineFd = -1;
+
+	int theBCMPin = wpiPinToGpio(aPin);
+	if (theBCMPin < 0 || theBCMPin >= GPIO_BCM_COUNT)
+	{
+		IOHUB_LOG_WARNING("Fast GPIO: no BCM pin for wiringPi pin %d, using digitalWrite", (int)aPin);
+		return;
+	}
+
+	volatile uint32_t *theMap = iohub_rpi_gpiomem_map();
+	if (theMap != NULL)
+	{
+		aGPIO->mSetReg = theMap + GPIO_REG_GPSET0 + (theBCMPin / 32);
+		aGPIO->mClearReg = theMap + GPIO_REG_GPCLR0 + (theBCMPin / 32);
+		aGPIO->mMask = 1UL << (theBCMPin % 32);
+		return;
+	}
+
+	aGPIO->mLineFd = iohub_rpi_chardev_request(theBCMPin);
+	if (aGPIO->mLineFd < 0)
+		IOHUB_LOG_WARNING("Fast GPIO: cannot request line %d, using digitalWrite", theBCMPin);
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_fast_gpio_uninit(iohub_fast_gpio *aGPIO)
+{
+		//The gpiomem mapping is shared by all handles and kept for the process lifetime
+	if (aGPIO->mLineFd >= 0)
+		close(aGPIO->mLineFd);
+
+	aGPIO->mLineFd = -1;
+}
+
+/* ------------------------------------------------------------- */
+
+void iohub_rpi_fast_gpio_write_slow(iohub_fast_gpio *aGPIO, int aLevel)
+{
+	if (aGPIO->mLineFd >= 0)
+	{
+		struct gpio_v2_line_values theValues;
+
+		theValues.mask = 1;
+		theValues.bits = aLevel ? 1 : 0;
+		ioctl(aGPIO->mLineFd, GPIO_V2_LINE_SET_VALUES_IOCTL, &theValues);
+		return;
+	}
+
+	digitalWrite(aGPIO->mPin, aLevel ? HIGH : LOW);
+}
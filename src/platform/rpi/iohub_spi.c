@@ -5,6 +5,7 @@
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 
 /*
  *  Enable SPI on raspberry pi:
@@ -19,7 +20,14 @@
 #define SPI_DEV             "/dev/spidev0.0"
 #define SPI_SPEED           100000 //100 KHZ
 
+/*
+    spidev is opened by the first iohub_spi_init() and shared by every device (own CS GPIO each),
+    closed by the last iohub_spi_uninit(). A device owns the bus from select to deselect, other
+    threads get it back between two transactions.
+*/
 static int              sSPIFD = 0;
+static u8               sSPIRefCount = 0;
+static pthread_mutex_t  sSPIBusMutex = PTHREAD_MUTEX_INITIALIZER;
 const static u8         spiMode  = 0 ;
 const static u8         spiBPW   = 8 ;
 const static u16        spiDelay = 0 ;
@@ -35,21 +43,27 @@ ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
 	aCtx->mCSnPin = aCSnPin;
 	aCtx->mMode = aMode;
 	
-    if ((sSPIFD = open (SPI_DEV, O_RDWR)) < 0)
-      return E_DEVICE_INIT_FAILED;
-
-    if (ioctl (sSPIFD, SPI_IOC_WR_MODE, &spiMode) < 0)
-        return E_DEVICE_INIT_FAILED;
-
-    if (ioctl (sSPIFD, SPI_IOC_WR_BITS_PER_WORD, &spiBPW) < 0)
-        return E_DEVICE_INIT_FAILED;
-
-    if (ioctl (sSPIFD, SPI_IOC_WR_MAX_SPEED_HZ, &theSpeed) < 0)
-        return E_DEVICE_INIT_FAILED;
+    if (sSPIRefCount == 0)
+    {
+        if ((sSPIFD = open (SPI_DEV, O_RDWR)) < 0)
+          return E_DEVICE_INIT_FAILED;
+
+        if (ioctl (sSPIFD, SPI_IOC_WR_MODE, &spiMode) < 0 ||
+            ioctl (sSPIFD, SPI_IOC_WR_BITS_PER_WORD, &spiBPW) < 0 ||
+            ioctl (sSPIFD, SPI_IOC_WR_MAX_SPEED_HZ, &theSpeed) < 0)
+        {
+            close(sSPIFD);
+            return E_DEVICE_INIT_FAILED;
+        }
+    }
+
+    sSPIRefCount++;
 
     theRet = iohub_digital_set_pin_mode(aCtx->mCSnPin, PinMode_Output);
     if (theRet == SUCCESS)
 		iohub_digital_write(aCtx->mCSnPin, PinLevel_High); //Deselect
+    else
+        iohub_spi_uninit(aCtx);
 
     return theRet;
 }
@@ -58,7 +72,8 @@ ret_code_t iohub_spi_init(spi_ctx *aCtx, u32 aCSnPin, IOHubSPIMode aMode)
 
 void iohub_spi_uninit(spi_ctx *aCtx)
 {
-    close(sSPIFD);
+    if (sSPIRefCount > 0 && --sSPIRefCount == 0)
+        close(sSPIFD);
 }
 
 /* ------------------------------------------------------------- */
@@ -69,6 +84,7 @@ void iohub_spi_select(spi_ctx *aCtx)
 
     if ( aCtx->mSelectedCount++ == 0 )
 	{
+        pthread_mutex_lock(&sSPIBusMutex);
         iohub_digital_write(aCtx->mCSnPin, PinLevel_Low);
 		
 		if (aCtx->mMode & SPIMode_WaitForMisoLowAfterSelect)
@@ -86,7 +102,10 @@ void iohub_spi_deselect(spi_ctx *aCtx)
 		return;
 	
     if ( --aCtx->mSelectedCount == 0 )
+    {
         iohub_digital_write(aCtx->mCSnPin, PinLevel_High);
+        pthread_mutex_unlock(&sSPIBusMutex);
+    }
 }
 
 /* ------------------------------------------------------------- */
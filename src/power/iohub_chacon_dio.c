@@ -1,5 +1,6 @@
 #include "power/iohub_chacon_dio.h"
 #include "platform/iohub_platform.h"
+#include "utils/iohub_tx_timing.h"
 
 //#define DEBUG
 #ifdef DEBUG
@@ -11,6 +12,7 @@
 #endif
 
 #define DRV_CHACON_DIO_RECV_ACCURACY     0.2
+#define DRV_CHACON_DIO_PAYLOAD_LEN		6
 
 	//Timing tuned for reception
 #define DRV_CHACON_DIO_HEADER_1			10700
@@ -22,10 +24,15 @@
 
 #ifdef ARDUINO
 	#define 	DRV_CHACON_WRITE(aLevel)	iohub_digital_write_4(aLevel)
+	#define 	DRV_CHACON_DELAY_US(aUs)	iohub_time_delay_us(aUs)
 #else
-	#define 	DRV_CHACON_WRITE(aLevel)	iohub_digital_write(aCtx->mDigitalPinTx, aLevel)
+	#define 	DRV_CHACON_WRITE(aLevel)	iohub_fast_gpio_write(&aCtx->mTxGPIO, aLevel)
+	#define 	DRV_CHACON_DELAY_US(aUs)	iohub_fast_gpio_delay_us(&aCtx->mTxGPIO, aUs)
 #endif
 
+#define DRV_CHACON_PULSE(aLevel, aDurationUs) \
+	do { DRV_CHACON_WRITE(aLevel); IOHUB_TX_TIMING_RECORD(aLevel, aDurationUs); DRV_CHACON_DELAY_US(aDurationUs); } while(0)
+
 /*
 	//Original timings for send
 #define DRV_CHACON_DIO_HEADER_1			9900
@@ -59,7 +66,11 @@ int iohub_chacon_dio_init(chacon_dio *aCtx, u8 aGPIOTx)
         aCtx->mDigitalPinTx = 4; //Default pin on arduino !
 #endif
 
-    iohub_digital_set_pin_mode(aCtx->mDigitalPinTx, PinMode_Output);
+    if (aCtx->mDigitalPinTx != IOHUB_GPIO_PIN_INVALID)
+    {
+        iohub_digital_set_pin_mode(aCtx->mDigitalPinTx, PinMode_Output);
+        iohub_fast_gpio_init(&aCtx->mTxGPIO, aCtx->mDigitalPinTx);
+    }
 	
     return theRet;
 }
@@ -68,16 +79,23 @@ int iohub_chacon_dio_init(chacon_dio *aCtx, u8 aGPIOTx)
 
 void iohub_chacon_dio_uninit(chacon_dio *aCtx)
 {
+    if (aCtx->mDigitalPinTx != IOHUB_GPIO_PIN_INVALID)
+        iohub_fast_gpio_uninit(&aCtx->mTxGPIO);
+}
+
+/* ----------------------------------------------------------------- */
+
+void iohub_chacon_dio_attach_receiver(chacon_dio *aCtx, digital_async_receiver *aReceiver)
+{
+    aCtx->mReceiver = aReceiver;
 }
 
 /* ----------------------------------------------------- */
 
 void iohub_chacon_dio_send_bit(chacon_dio *aCtx, u8 aBit) 
 {
-    DRV_CHACON_WRITE(PinLevel_High);
-    iohub_time_delay_us(DRV_CHACON_DIO_CLK);
-    DRV_CHACON_WRITE(PinLevel_Low);
-    iohub_time_delay_us(aBit ? DRV_CHACON_DIO_BIT_1 : DRV_CHACON_DIO_BIT_0);
+    DRV_CHACON_PULSE(PinLevel_High, DRV_CHACON_DIO_CLK);
+    DRV_CHACON_PULSE(PinLevel_Low, aBit ? DRV_CHACON_DIO_BIT_1 : DRV_CHACON_DIO_BIT_0);
 }
 
 /* ----------------------------------------------------- */
@@ -89,23 +107,41 @@ void iohub_chacon_dio_send_pair(chacon_dio *aCtx, u8 aBit)
     iohub_chacon_dio_send_bit(aCtx, !aBit);
 }
 
+/* ----------------------------------------------------- */
+
+	//Echo matching payload, same layout for send and receive
+static u8 iohub_chacon_dio_pack_payload(u8 *aBuffer, u32 aSenderID, u8 aReceiverID, BOOL afON)
+{
+	aBuffer[0] = (u8)(aSenderID >> 24);
+	aBuffer[1] = (u8)(aSenderID >> 16);
+	aBuffer[2] = (u8)(aSenderID >> 8);
+	aBuffer[3] = (u8)aSenderID;
+	aBuffer[4] = aReceiverID;
+	aBuffer[5] = afON ? 1 : 0;
+
+	return DRV_CHACON_DIO_PAYLOAD_LEN;
+}
+
 /* ----------------------------------------------------- */
 
 void iohub_chacon_dio_send(chacon_dio *aCtx, BOOL afON, u32 aSenderID, u8 aReceiverID)
 {
     int         i;
+	u8			thePayload[DRV_CHACON_DIO_PAYLOAD_LEN];
+
+	if (aCtx->mReceiver != NULL)
+		iohub_digital_async_receiver_tx_begin(aCtx->mReceiver, DRV_CHACON_DIO_ID, thePayload,
+											  iohub_chacon_dio_pack_payload(thePayload, aSenderID, aReceiverID, afON));
+
+	iohub_fast_gpio_waveform_begin(&aCtx->mTxGPIO);
 
 	for (int k=0; k<2; k++) //Send data 2 times
 	{
 			//Header
-		DRV_CHACON_WRITE(PinLevel_High);
-		iohub_time_delay_us(DRV_CHACON_DIO_CLK);
-		DRV_CHACON_WRITE(PinLevel_Low);
-		iohub_time_delay_us(DRV_CHACON_DIO_HEADER_1);   
-		DRV_CHACON_WRITE(PinLevel_High);
-		iohub_time_delay_us(DRV_CHACON_DIO_CLK);
-		DRV_CHACON_WRITE(PinLevel_Low);
-		iohub_time_delay_us(DRV_CHACON_DIO_HEADER_2);
+		DRV_CHACON_PULSE(PinLevel_High, DRV_CHACON_DIO_CLK);
+		DRV_CHACON_PULSE(PinLevel_Low, DRV_CHACON_DIO_HEADER_1);
+		DRV_CHACON_PULSE(PinLevel_High, DRV_CHACON_DIO_CLK);
+		DRV_CHACON_PULSE(PinLevel_Low, DRV_CHACON_DIO_HEADER_2);
 		DRV_CHACON_WRITE(PinLevel_High);
 	 
 			//Send emitor ID
@@ -123,11 +159,14 @@ void iohub_chacon_dio_send(chacon_dio *aCtx, BOOL afON, u32 aSenderID, u8 aRecei
 			iohub_chacon_dio_send_pair(aCtx, (aReceiverID >> (3 - i)) & 0x01);
 	 
 			//Footer
-		DRV_CHACON_WRITE(PinLevel_High);
-		iohub_time_delay_us(DRV_CHACON_DIO_CLK);
-		DRV_CHACON_WRITE(PinLevel_Low);
-		iohub_time_delay_us(DRV_CHACON_DIO_CLK);
+		DRV_CHACON_PULSE(PinLevel_High, DRV_CHACON_DIO_CLK);
+		DRV_CHACON_PULSE(PinLevel_Low, DRV_CHACON_DIO_CLK);
 	}
+
+	iohub_fast_gpio_waveform_end(&aCtx->mTxGPIO);
+
+	if (aCtx->mReceiver != NULL)
+		iohub_digital_async_receiver_tx_end(aCtx->mReceiver);
 }
 	
 /* ----------------------------------------------------- */
@@ -281,6 +320,31 @@ BOOL iohub_chacon_dio_detectPacket(digital_async_receiver_interface_ctx *aCtx, u
 
 /* ----------------------------------------------------- */
 
+u8 iohub_chacon_dio_getPayload(digital_async_receiver_interface_ctx *aCtx, u8 *aBuffer, u8 aBufferLen)
+{
+	chacon_dio *theCtx = (chacon_dio *)aCtx;
+	u16			theReadIdx = theCtx->mTimingReadIdx;
+	u32			theSenderID;
+	u8			theReceiverID;
+	BOOL		theON;
+	BOOL		theRet;
+
+	if (aBufferLen < DRV_CHACON_DIO_PAYLOAD_LEN)
+		return 0;
+
+		//Decode without consuming the frame, the caller still reads it
+	theCtx->mTimingReadIdx = 0;
+	theRet = iohub_chacon_dio_read(theCtx, &theSenderID, &theReceiverID, &theON);
+	theCtx->mTimingReadIdx = theReadIdx;
+
+	if (!theRet)
+		return 0;
+
+	return iohub_chacon_dio_pack_payload(aBuffer, theSenderID, theReceiverID, theON);
+}
+
+/* ----------------------------------------------------- */
+
 void iohub_chacon_dio_packetHandled(digital_async_receiver_interface_ctx *aCtx)
 {
 	chacon_dio *theCtx = (chacon_dio *)aCtx;
@@ -308,7 +372,8 @@ const digital_async_receiver_interface  *iohub_chacon_dio_get_interface(void)
 	{
 		DRV_CHACON_DIO_ID,
 		iohub_chacon_dio_detectPacket,
-		iohub_chacon_dio_packetHandled
+		iohub_chacon_dio_packetHandled,
+		iohub_chacon_dio_getPayload
 	};
 	
 	return &sInterface;
@@ -187,7 +187,8 @@ const digital_async_receiver_interface  *iohub_digoo_r8h_get_interface(void)
 	{
 		DRV_DIGOO_R8H_ID,
 		iohub_digoo_r8h_detectPacket,
-		iohub_digoo_r8h_packetHandled
+		iohub_digoo_r8h_packetHandled,
+		NULL	//Receive only, never echoed
 	};
 	
 	return &sInterface;
@@ -189,7 +189,8 @@ const digital_async_receiver_interface  *iohub_rs8706w_weatherlink_get_interface
 	{
 		DRV_RS8706W_ID,
 		iohub_rs8706w_weatherlink_detectPacket,
-		iohub_rs8706w_weatherlink_packetHandled
+		iohub_rs8706w_weatherlink_packetHandled,
+		NULL	//Receive only, never echoed
 	};
 	
 	return &sInterface;
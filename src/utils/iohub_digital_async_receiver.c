@@ -1,11 +1,31 @@
 #include "utils/iohub_digital_async_receiver.h"
 #include "platform/iohub_platform.h"
+#include "utils/iohub_logs.h"
 
 //#define DEBUG_ASYNC_RECEIVER 1
 #ifdef DEBUG_ASYNC_RECEIVER
 volatile static u32 				gDurationUs = 0;
 #endif
 
+/* --------------------------------------------------- */
+
+	//TRUE while a local transmission is on air or within its guard time
+	static inline BOOL IRAM_ATTR digital_async_receiver_in_tx_window(digital_async_receiver *ctx, u32 aTimeUs)
+	{
+		if (ctx->mfTxActive)
+			return TRUE;
+
+		if (ctx->mfTxGuard)
+		{
+			if ((aTimeUs - ctx->mTxEndTimeUs) < ctx->mTxGuardUs)
+				return TRUE;
+
+			ctx->mfTxGuard = FALSE;
+		}
+
+		return FALSE;
+	}
+
 /* --------------------------------------------------- */
 
 	//This function is timing dependant
@@ -23,12 +43,22 @@ volatile static u32 				gDurationUs = 0;
 		gDurationUs = theDurationUs;
 #endif
 
+		BOOL theInTxWindow = digital_async_receiver_in_tx_window(ctx, theTimeUs);
+		if (theInTxWindow && ctx->mEchoMode == DigitalAsyncReceiverEcho_Drop)
+			return; //Our own transmission, do not burn CPU decoding it
+
 		for(u8 i=0; i<ctx->mPluginCount; i++)
 		{
+			if (theInTxWindow && ctx->mInterfaceList[i]->Id != ctx->mTxReceiverId)
+				continue;
+
 			if (!IOHUB_GPIO_IS_BIT_SET(ctx->mPacketReady, i))
 			{
 				if (ctx->mInterfaceList[i]->detectPacket(ctx->mInterfaceCtx[i], (u16)theDurationUs))
 				{
+					if (theInTxWindow)
+						IOHUB_GPIO_BIT_SET(ctx->mPacketInTxWindow, i); //Matched against the sent payload by is_echo, decoding here is too slow
+
 					IOHUB_GPIO_BIT_SET(ctx->mPacketReady, i);
 				}
 			}
@@ -43,6 +73,8 @@ void iohub_digital_async_receiver_init(digital_async_receiver *ctx, u8 aPin)
 
 	ctx->mPin = aPin;
 	ctx->mLastTimeUs = iohub_time_now_us();
+	ctx->mEchoMode = DigitalAsyncReceiverEcho_Drop;
+	ctx->mTxGuardUs = DIGITAL_ASYNC_RECEIVER_TX_GUARD_US;
 	
 	iohub_digital_set_pin_mode(aPin, PinMode_Input);
 }
@@ -66,7 +98,7 @@ void iohub_digital_async_receiver_start(digital_async_receiver *ctx)
 										   IOHUB_GPIO_INT_TYPE_CHANGE, 
 										   ctx);
 	if (ret != SUCCESS) {
-		IOHUB_LOG_ERROR("Failed to attach interrupt to pin %d: %s", ctx->mPin, esp_err_to_name(ret));
+		IOHUB_LOG_ERROR("Failed to attach interrupt to pin %d: %d", ctx->mPin, ret);
 	}
 }
 
@@ -76,7 +108,7 @@ void iohub_digital_async_receiver_stop(digital_async_receiver *ctx)
 {
 	ret_code_t ret = iohub_detach_interrupt(ctx->mPin);
 	if (ret != SUCCESS) {
-		IOHUB_LOG_ERROR("Failed to detach interrupt from pin %d: %s", ctx->mPin, esp_err_to_name(ret));
+		IOHUB_LOG_ERROR("Failed to detach interrupt from pin %d: %d", ctx->mPin, ret);
 	}
 
 	ctx->mIsRunning = FALSE;
@@ -146,6 +178,7 @@ void iohub_digital_async_receiver_packet_handled(digital_async_receiver *ctx, u1
 		if (ctx->mInterfaceList[i]->Id == receiverId)
 		{
 			ctx->mInterfaceList[i]->packetHandled(ctx->mInterfaceCtx[i]);
+			IOHUB_GPIO_BIT_CLEAR(ctx->mPacketInTxWindow, i);
 			IOHUB_GPIO_BIT_CLEAR(ctx->mPacketReady, i);
 			return;
 		}
@@ -166,3 +199,87 @@ void iohub_digital_async_receiver_real_time_dump(digital_async_receiver *ctx)
 	}
 #endif
 }
+
+/* --------------------------------------------------- */
+
+void iohub_digital_async_receiver_set_echo_mode(digital_async_receiver *ctx, DigitalAsyncReceiverEchoMode aMode, u32 aGuardUs)
+{
+	ctx->mEchoMode = aMode;
+	ctx->mTxGuardUs = aGuardUs;
+}
+
+/* --------------------------------------------------- */
+
+void iohub_digital_async_receiver_tx_begin(digital_async_receiver *ctx, u16 receiverId, const u8 *aPayload, u8 aPayloadLen)
+{
+	for(u8 i=0; i<ctx->mPluginCount; i++)
+	{
+		if (ctx->mInterfaceList[i]->Id != receiverId)
+			continue;
+
+		ctx->mTxPayloadLen[i] = 0; //Never tagged if the payload does not fit
+		if (aPayload != NULL && aPayloadLen <= DIGITAL_ASYNC_RECEIVER_ECHO_PAYLOAD_MAX)
+		{
+			memcpy(ctx->mTxPayload[i], aPayload, aPayloadLen);
+			ctx->mTxPayloadLen[i] = aPayloadLen;
+		}
+		else
+			IOHUB_LOG_ERROR("Echo payload too large for receiverId %d: %d", receiverId, aPayloadLen);
+	}
+
+	iohub_interrupts_disable();
+
+	ctx->mTxReceiverId = receiverId;
+	ctx->mfTxActive = TRUE;
+
+		//Drop partially decoded frames, they would be corrupted by our transmission
+	for(u8 i=0; i<ctx->mPluginCount; i++)
+	{
+		if (!IOHUB_GPIO_IS_BIT_SET(ctx->mPacketReady, i))
+			ctx->mInterfaceList[i]->packetHandled(ctx->mInterfaceCtx[i]);
+	}
+
+	iohub_interrupts_enable();
+}
+
+/* --------------------------------------------------- */
+
+void iohub_digital_async_receiver_tx_end(digital_async_receiver *ctx)
+{
+	iohub_interrupts_disable();
+
+	ctx->mTxEndTimeUs = iohub_time_now_us();
+	ctx->mfTxGuard = (ctx->mTxGuardUs > 0);
+	ctx->mfTxActive = FALSE;
+
+	iohub_interrupts_enable();
+}
+
+/* --------------------------------------------------- */
+
+BOOL iohub_digital_async_receiver_is_echo(digital_async_receiver *ctx, u16 receiverId)
+{
+	u8		theBuffer[DIGITAL_ASYNC_RECEIVER_ECHO_PAYLOAD_MAX];
+	u8		theLen;
+
+	for(u8 i=0; i<ctx->mPluginCount; i++)
+	{
+		if (ctx->mInterfaceList[i]->Id != receiverId)
+			continue;
+
+		if (!IOHUB_GPIO_IS_BIT_SET(ctx->mPacketReady, i) || !IOHUB_GPIO_IS_BIT_SET(ctx->mPacketInTxWindow, i))
+			return FALSE;
+
+			//A foreign frame decoded in the tx window is not an echo, only our own payload is
+		if (ctx->mInterfaceList[i]->getPayload == NULL || ctx->mTxPayloadLen[i] == 0)
+			return FALSE;
+
+		theLen = ctx->mInterfaceList[i]->getPayload(ctx->mInterfaceCtx[i], theBuffer, sizeof(theBuffer));
+		if (theLen != ctx->mTxPayloadLen[i])
+			return FALSE;
+
+		return (memcmp(theBuffer, ctx->mTxPayload[i], theLen) == 0) ? TRUE : FALSE;
+	}
+
+	return FALSE;
+}
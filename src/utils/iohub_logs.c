@@ -28,10 +28,10 @@ void iohub_log(iohub_log_level_t level, const char *fmt, ...)
     } else {
         const char *lvl_str = "UNKNOWN";
         switch (level) {
-            case IOHUB_LOG_DEBUG:   lvl_str = "DEBUG"; break;
-            case IOHUB_LOG_INFO:    lvl_str = "INFO"; break;
-            case IOHUB_LOG_WARNING: lvl_str = "WARNING"; break;
-            case IOHUB_LOG_ERROR:   lvl_str = "ERROR"; break;
+            case IOHUB_LOGLVL_DEBUG:   lvl_str = "DEBUG"; break;
+            case IOHUB_LOGLVL_INFO:    lvl_str = "INFO"; break;
+            case IOHUB_LOGLVL_WARNING: lvl_str = "WARNING"; break;
+            case IOHUB_LOGLVL_ERROR:   lvl_str = "ERROR"; break;
         }
         fprintf(stdout, "[%s] %s\n", lvl_str, buffer);
     }
@@ -0,0 +1,164 @@
+#include "utils/iohub_tx_timing.h"
+#include "utils/iohub_logs.h"
+
+#ifdef IOHUB_TX_TIMING
+
+typedef struct tx_timing_edge_s
+{
+	u32				mTimeUs;
+	u32				mExpectedUs;
+	IOHubPinLevel	mLevel;
+}tx_timing_edge;
+
+static tx_timing_edge		sEdges[IOHUB_TX_TIMING_MAX_EDGES];
+static u16					sEdgeCount = 0;
+static BOOL					sfRecording = FALSE;
+static BOOL					sfOverflow = FALSE;
+static u32					sStopTimeUs = 0;
+
+static u32					sErrors[IOHUB_TX_TIMING_MAX_EDGES]; //Scratch buffer for percentiles
+
+/* --------------------------------------------------- */
+
+void iohub_tx_timing_start(void)
+{
+	sEdgeCount = 0;
+	sfOverflow = FALSE;
+	sfRecording = TRUE;
+}
+
+/* --------------------------------------------------- */
+
+void iohub_tx_timing_stop(void)
+{
+	sStopTimeUs = (u32)iohub_time_now_us();
+	sfRecording = FALSE;
+}
+
+/* --------------------------------------------------- */
+
+	//Called from transmit loops, keep it short
+void iohub_tx_timing_record(IOHubPinLevel aLevel, u32 anExpectedUs)
+{
+	u32 theTimeUs = (u32)iohub_time_now_us();
+
+	if (!sfRecording)
+		return;
+
+	if (sEdgeCount >= IOHUB_TX_TIMING_MAX_EDGES)
+	{
+		sfOverflow = TRUE;
+		return;
+	}
+
+	sEdges[sEdgeCount].mTimeUs = theTimeUs;
+	sEdges[sEdgeCount].mExpectedUs = anExpectedUs;
+	sEdges[sEdgeCount].mLevel = aLevel;
+	sEdgeCount++;
+}
+
+/* --------------------------------------------------- */
+
+static int iohub_tx_timing_compare(const void *a, const void *b)
+{
+	u32 theA = *(const u32 *)a;
+	u32 theB = *(const u32 *)b;
+
+	return (theA > theB) - (theA < theB);
+}
+
+/* --------------------------------------------------- */
+
+static s32 iohub_tx_timing_error(u16 anEdgeIdx)
+{
+	u32 theEndUs = (anEdgeIdx + 1 < sEdgeCount) ? sEdges[anEdgeIdx + 1].mTimeUs : sStopTimeUs;
+	u32 theMeasuredUs = theEndUs - sEdges[anEdgeIdx].mTimeUs;
+
+	return (s32)theMeasuredUs - (s32)sEdges[anEdgeIdx].mExpectedUs;
+}
+
+/* --------------------------------------------------- */
+
+ret_code_t iohub_tx_timing_analyze(tx_timing_report *aReport)
+{
+	memset(aReport, 0x00, sizeof(tx_timing_report));
+
+	if (sfRecording)
+		return E_INVALID_STATE;
+
+	aReport->mEdgeCount = sEdgeCount;
+	aReport->mfOverflow = sfOverflow;
+
+	for (u16 i=0; i<sEdgeCount; i++)
+	{
+		u8 theSymbolIdx;
+
+		for (theSymbolIdx=0; theSymbolIdx<aReport->mSymbolCount; theSymbolIdx++)
+		{
+			if (aReport->mSymbols[theSymbolIdx].mLevel == sEdges[i].mLevel &&
+				aReport->mSymbols[theSymbolIdx].mExpectedUs == sEdges[i].mExpectedUs)
+				break;
+		}
+
+		if (theSymbolIdx == aReport->mSymbolCount)
+		{
+			if (aReport->mSymbolCount >= IOHUB_TX_TIMING_MAX_SYMBOLS)
+			{
+				aReport->mfOverflow = TRUE;
+				continue;
+			}
+
+			aReport->mSymbols[theSymbolIdx].mLevel = sEdges[i].mLevel;
+			aReport->mSymbols[theSymbolIdx].mExpectedUs = sEdges[i].mExpectedUs;
+			aReport->mSymbolCount++;
+		}
+	}
+
+	for (u8 s=0; s<aReport->mSymbolCount; s++)
+	{
+		tx_timing_symbol *theSymbol = &aReport->mSymbols[s];
+		long long theSumUs = 0;
+		u16 theCount = 0;
+
+		for (u16 i=0; i<sEdgeCount; i++)
+		{
+			if (sEdges[i].mLevel != theSymbol->mLevel || sEdges[i].mExpectedUs != theSymbol->mExpectedUs)
+				continue;
+
+			s32 theErrorUs = iohub_tx_timing_error(i);
+			theSumUs += theErrorUs;
+			sErrors[theCount++] = (u32)((theErrorUs < 0) ? -theErrorUs : theErrorUs);
+		}
+
+		qsort(sErrors, theCount, sizeof(u32), iohub_tx_timing_compare);
+
+		theSymbol->mCount = theCount;
+		theSymbol->mMeanErrorUs = (s32)(theSumUs / theCount);
+		theSymbol->mP99ErrorUs = sErrors[((theCount * 99) + 99) / 100 - 1];
+		theSymbol->mMaxErrorUs = sErrors[theCount - 1];
+	}
+
+	return SUCCESS;
+}
+
+/* --------------------------------------------------- */
+
+void iohub_tx_timing_dump(const tx_timing_report *aReport)
+{
+	IOHUB_LOG_INFO("TX timing: %u edges%s", aReport->mEdgeCount, aReport->mfOverflow ? " (overflow)" : "");
+
+	for (u8 s=0; s<aReport->mSymbolCount; s++)
+	{
+		const tx_timing_symbol *theSymbol = &aReport->mSymbols[s];
+
+		IOHUB_LOG_INFO("  %s %6lu us: count=%u mean=%ld us p99=%lu us max=%lu us",
+						theSymbol->mLevel == PinLevel_High ? "HIGH" : "LOW ",
+						theSymbol->mExpectedUs,
+						theSymbol->mCount,
+						theSymbol->mMeanErrorUs,
+						theSymbol->mP99ErrorUs,
+						theSymbol->mMaxErrorUs);
+	}
+}
+
+#endif